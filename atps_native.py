@@ -0,0 +1,140 @@
+#!/bin/python3
+
+import sys
+import json
+import ctypes
+import os.path
+
+import numpy as np
+
+# Runs a scenario inside this python process, through the library that make atps_native builds, bin/libatps_native.so
+# The run is stepped from python and the particles are read straight out of the library's memory, with no logging or text in between.
+#
+#   sim = Simulation("tests/scenarios/2d_8p_planned.json")
+#   while sim.step() < 30:
+#       ids, pos, vel = sim.snapshot()
+#
+# The arrays snapshot returns are views onto the library's own arrays, not copies,
+# they are only good until the next snapshot or close, copy them to keep them past that.
+
+default_library = os.path.join(os.path.dirname(os.path.abspath(__file__)), "bin", "libatps_native.so")
+
+_size_p = ctypes.POINTER(ctypes.c_size_t)
+_double_p = ctypes.POINTER(ctypes.c_double)
+
+
+def load_library(path = default_library):
+    lib = ctypes.CDLL(path)
+    signatures = {
+        "atps_error":       ([], ctypes.c_char_p),
+        "atps_dims":        ([], ctypes.c_size_t),
+        "atps_open":        ([ctypes.c_char_p], ctypes.c_void_p),
+        "atps_open_json":   ([ctypes.c_char_p], ctypes.c_void_p),
+        "atps_close":       ([ctypes.c_void_p], None),
+        "atps_run_until":   ([ctypes.c_void_p, ctypes.c_double], ctypes.c_double),
+        "atps_step":        ([ctypes.c_void_p], ctypes.c_double),
+        "atps_time":        ([ctypes.c_void_p], ctypes.c_double),
+        "atps_next":        ([ctypes.c_void_p], ctypes.c_double),
+        "atps_snapshot":    ([ctypes.c_void_p], ctypes.c_size_t),
+        "atps_ids":         ([ctypes.c_void_p], _size_p),
+        "atps_species":     ([ctypes.c_void_p], _size_p),
+        "atps_mass":        ([ctypes.c_void_p], _double_p),
+        "atps_radius":      ([ctypes.c_void_p], _double_p),
+        "atps_positions":   ([ctypes.c_void_p], _double_p),
+        "atps_velocities":  ([ctypes.c_void_p], _double_p),
+    }
+    for name, (args, result) in signatures.items():
+        fn = getattr(lib, name)
+        fn.argtypes = args
+        fn.restype = result
+    return lib
+
+
+def _view(pointer, shape):
+    #numpy can not wrap a null pointer, which is what an empty vector may hand out
+    if shape[0] == 0:
+        return np.empty(shape, dtype = np.ctypeslib.as_ctypes_type(pointer._type_))
+    return np.ctypeslib.as_array(pointer, shape = shape)
+
+
+class Simulation:
+    def __init__(self, scenario, library = None):
+        self.handle = None
+        self.count = 0
+        self.lib = library if library is not None else load_library()
+        self.dims = self.lib.atps_dims()
+        if isinstance(scenario, dict):
+            self.handle = self.lib.atps_open_json(json.dumps(scenario).encode())
+        else:
+            self.handle = self.lib.atps_open(str(scenario).encode())
+        if not self.handle:
+            raise RuntimeError(self.lib.atps_error().decode())
+
+    def _checked(self, t):
+        if t != t:
+            raise RuntimeError(self.lib.atps_error().decode())
+        return t
+
+    def run_until(self, t):
+        #runs every event up to and including t, returns when the next one is
+        return self._checked(self.lib.atps_run_until(self.handle, t))
+
+    def step(self):
+        #runs the next event, returns the time it was at, inf once nothing is left to happen
+        t = self.lib.atps_next(self.handle)
+        self._checked(self.lib.atps_step(self.handle))
+        return t
+
+    @property
+    def time(self):
+        return self.lib.atps_time(self.handle)
+
+    def snapshot(self):
+        #ids, positions and velocities of every particle at self.time, positions and velocities are count x dims
+        count = self.count = self.lib.atps_snapshot(self.handle)
+        return (
+            _view(self.lib.atps_ids(self.handle), (count,)),
+            _view(self.lib.atps_positions(self.handle), (count, self.dims)),
+            _view(self.lib.atps_velocities(self.handle), (count, self.dims)),
+        )
+
+    def properties(self):
+        #species, mass and radius of every particle, in the same order as the last snapshot
+        count = self.count
+        return (
+            _view(self.lib.atps_species(self.handle), (count,)),
+            _view(self.lib.atps_mass(self.handle), (count,)),
+            _view(self.lib.atps_radius(self.handle), (count,)),
+        )
+
+    def close(self):
+        if self.handle:
+            self.lib.atps_close(self.handle)
+            self.handle = None
+
+    def __enter__(self):
+        return self
+
+    def __exit__(self, *exc):
+        self.close()
+
+    def __del__(self):
+        self.close()
+
+
+if __name__ == "__main__":
+    if len(sys.argv) < 2 or '-h' in sys.argv[1]:
+        print(
+        'Usage: \n'+
+        '\tpython3 atps_native.py scenario.json <end time> <timestep size>             #prints [time, {p_id:[pos]}] every timestep until end time, like output_tools.py does from a log\n')
+        sys.exit(0)
+
+    end_time = 5.0 if len(sys.argv) <= 2 else float(sys.argv[2])
+    dt       = 1.0 if len(sys.argv) <= 3 else float(sys.argv[3])
+    with Simulation(sys.argv[1]) as sim:
+        t = 0.0
+        while t <= end_time:
+            sim.run_until(t)
+            ids, pos, vel = sim.snapshot()
+            print(json.dumps([t, {int(i):list(p) for i,p in zip(ids, pos.tolist())}]))
+            t += dt
@@ -3,6 +3,13 @@
 
 import sys
 import json
+import re
+
+def json_entries(text):
+    #the messages on one port, a message the log filter left out prints as nothing, but the commas around it are still there
+    text = re.sub(r'^\s*,|,\s*(?=,|$)', '', text.strip())
+    return json.loads('[' + text + ']') if text.strip() else []
+
 
 def parse_msg_file(msg_file):
     start_s = ">::particle_announcement: {"
@@ -15,14 +22,65 @@ def parse_msg_file(msg_file):
             #this is a time change
             time = float(line.strip())
         elif start_s in line:
-            #this is a line with particle info
+            #this is a line with particle info, one announcement per volume that had anything to say
             start_i = line.find(start_s)+len(start_s)
             end_i   = line.find(end_s, start_i)
             if(end_i > start_i):
-                v_id, dv, leaving = json.loads(line[start_i:end_i])
+                for v_id, dv, leaving in json_entries(line[start_i:end_i]):
+                    for p_time, p_id, p_species, p_mass, p_radius, p_pos, p_vel, *p_deferred_dv_and_time in dv:
+                        yield([time, p_id, p_time, p_pos, p_vel])
+
+
+def parse_state_file(state_file):
+    #yields [time, volume] for every volume state in a state log, the volumes a sparse grid holds included
+    #a volume is its json record, with either all of its particles, or what changed and was removed since its last record
+    start_s = "State for model "
+    state_s = " is "
+    #c++ prints infinities as inf, json wants Infinity
+    inf_re = re.compile(r'(?<![A-Za-z"])inf(?![A-Za-z"])')
 
-                for p_time, p_id, p_species, p_mass, p_radius, p_pos, p_vel, *p_deferred_dv_and_time in dv:
-                    yield([time, p_id, p_time, p_pos, p_vel])
+    time = float('-inf')
+    for line in state_file:
+        if line.strip().replace('.','',1).isdigit():
+            time = float(line.strip())
+        elif line.startswith(start_s):
+            text = line[line.find(state_s, len(start_s))+len(state_s):].strip()
+            if not text.startswith('{'):
+                continue
+            try:
+                record = json.loads(inf_re.sub('Infinity', text))
+            except ValueError:
+                #not a volume, or a grid of them
+                continue
+            for volume in record.get("volumes", [record]):
+                if "id" in volume:
+                    yield [time, volume]
+
+
+def replay_states(volumes, times):
+    #the same as quantize_state_to_times, from the volume records of a state log instead of the announcements
+    #each volume starts over from scratch at each of its keyframes, so only its records since its last keyframe before a time matter
+    held = {}
+    next_volume = next(volumes, None)
+    for output_time in times:
+        while next_volume is not None and next_volume[0] < output_time:
+            _, volume = next_volume
+            v_id = tuple(volume["id"])
+            if "particles" in volume:
+                held[v_id] = {p[1]:p for p in volume["particles"]}
+            else:
+                particles = held.setdefault(v_id, {})
+                for p in volume["changed"]:
+                    particles[p[1]] = p
+                for p_id in volume["removed"]:
+                    particles.pop(p_id, None)
+            next_volume = next(volumes, None)
+
+        out = {}
+        for particles in held.values():
+            for p_time, p_id, p_species, p_mass, p_radius, p_pos, p_vel, *p_deferred_dv_and_time in particles.values():
+                out[p_id] = list([p+v*(output_time-p_time) for p,v in zip(p_pos, p_vel)])
+        yield output_time, out
 
 
 def quantize_state_to_times(events, times):
@@ -51,6 +109,10 @@ def float_range_helper(start, end, step):
 
 if __name__ == "__main__":
     #print(str(sys.argv))
+    #--states reads a state log, as keyframes and deltas or as full states, instead of a message log
+    from_states = len(sys.argv) > 1 and sys.argv[1] == '--states'
+    if from_states:
+        sys.argv.pop(1)
     if len(sys.argv) > 1 and '-h' in sys.argv[1]:
         print(
         'Usage: \n'+
@@ -58,12 +120,15 @@ if __name__ == "__main__":
         '\tpython3 output_tools.py messages.txt                                         #as if messages.txt was piped in\n'+
         '\tpython3 output_tools.py messages.txt <end time>                              #at each time in [0.0, end] with a stepsize of 1.0, print a snapeshot of the state, of the form [time, {p_id:[pos]}]\n'+
         '\tpython3 output_tools.py messages.txt <end time> <timestep size>              #as the last case, but with the specified step size instead of 1.0\n'+
-        '\tpython3 output_tools.py messages.txt <end time> <timestep size> <start time> #as the last case, but with the specified start time instead of 0.0\n'
+        '\tpython3 output_tools.py messages.txt <end time> <timestep size> <start time> #as the last case, but with the specified start time instead of 0.0\n'+
+        '\tpython3 output_tools.py --states state.txt ...                               #any of the above from a state log, events are [time, volume record]\n'
         )
         exit()
+    parse = parse_state_file if from_states else parse_msg_file
+    quantize = replay_states if from_states else quantize_state_to_times
     if len(sys.argv) == 2:
         with open(sys.argv[1]) as msg_file:
-            for event in parse_msg_file(msg_file):
+            for event in parse(msg_file):
                 print(event)
     elif len(sys.argv) > 2:
         #end | end, step size | end, step size, start
@@ -80,9 +145,9 @@ if __name__ == "__main__":
             print(f"step:{step} is <0, we can only walk forwards through the input, we cannot produce states out of order or in reverse order like this")
             exit(-1)
         with open(sys.argv[1]) as msg_file:
-            for state in quantize_state_to_times(parse_msg_file(msg_file), float_range_helper(start, end, step)):
+            for state in quantize(parse(msg_file), float_range_helper(start, end, step)):
                 print(state)
 
     else:
-        for event in parse_msg_file(sys.stdin):
+        for event in parse(sys.stdin):
             print(event)
@@ -0,0 +1,188 @@
+#!/bin/python3
+
+import json
+import math
+import argparse
+
+# Picks a volume grid and a split between worker processes for a scenario, before it is run.
+#
+# The cost model counts the work the collider does when particles migrate:
+#   every migration dirties two volumes, and each dirty volume is scanned pair by pair against its 3^DIMS neighbourhood,
+#   so one migration out of a volume holding c particles, with n particles in its neighbourhood, costs about migrate_cost + 2*c*n
+#   the expected migration rate of one particle is sum_i E|v_i|/s_i, from the same exit times move_out_time works out
+# Big volumes migrate rarely but every scan is expensive, small volumes scan cheaply but migrate all of the time.
+# Volumes are never made smaller than the biggest particle diameter, a particle has to fit in a volume for the collider's neighbour check to hold.
+
+
+def expected_abs_velocity(velocity, dims):
+    #E|v_i| for each axis, from either a normal distribution per axis or from samples
+    if "samples" in velocity:
+        samples = velocity["samples"]
+        return [sum(abs(v[i]) for v in samples)/max(len(samples), 1) for i in range(dims)]
+    out = []
+    for mean, sigma in zip(velocity["mean"], velocity["sigma"]):
+        if sigma <= 0:
+            out.append(abs(mean))
+        else:
+            #the mean of a folded normal distribution
+            out.append(sigma*math.sqrt(2/math.pi)*math.exp(-mean*mean/(2*sigma*sigma)) + mean*math.erf(mean/(sigma*math.sqrt(2))))
+    return out
+
+
+def bounding_box(particles, dims):
+    pad = max(p[4] for p in particles)
+    low  = [min(p[5][i] for p in particles)-pad for i in range(dims)]
+    high = [max(p[5][i] for p in particles)+pad for i in range(dims)]
+    return low, high
+
+
+def volume_of(position, corner, size, grid):
+    return tuple(min(max(int(math.floor((position[i]-corner[i])/size[i])), 0), grid[i]-1) for i in range(len(grid)))
+
+
+def neighbours(vid):
+    out = [()]
+    for i in vid:
+        out = [n+(i+step,) for n in out for step in (-1, 0, 1)]
+    return out
+
+
+def grid_cost(particles, corner, size, grid, abs_velocity, migrate_cost):
+    counts = {}
+    for p in particles:
+        vid = volume_of(p[5], corner, size, grid)
+        counts[vid] = counts.get(vid, 0)+1
+
+    #the expected scan cost of a migration, averaged over which particle migrates
+    scan = 0
+    for vid, c in counts.items():
+        n = sum(counts.get(nid, 0) for nid in neighbours(vid))
+        scan += c*(2*c*n)
+    scan /= len(particles)
+
+    migration_rate = len(particles)*sum(v/s for v, s in zip(abs_velocity, size))
+    return migration_rate*(migrate_cost+scan), migration_rate, max(counts.values())
+
+
+def plan_grid(particles, dims, abs_velocity, migrate_cost, steps = 64):
+    low, high = bounding_box(particles, dims)
+    extent = [max(h-l, 0) for l, h in zip(low, high)]
+    min_size = 2*max(p[4] for p in particles)
+
+    #for a fixed volume, sum_i E|v_i|/s_i is smallest with s_i in proportion to E|v_i|, so only the overall scale is searched
+    mean_v = math.exp(sum(math.log(max(v, 1e-12)) for v in abs_velocity)/dims)
+    aspect = [max(v, 1e-12)/mean_v for v in abs_velocity]
+
+    best = None
+    seen = set()
+    biggest = max(extent)/min(aspect) if max(extent) > 0 else min_size
+    for k in range(steps+1):
+        scale = min_size*(max(biggest/min_size, 1)**(k/steps))
+        grid = []
+        for i in range(dims):
+            most = max(int(extent[i]//min_size), 1)
+            grid.append(min(max(int(round(extent[i]/(scale*aspect[i]))), 1), most))
+        grid = tuple(grid)
+        if grid in seen:
+            continue
+        seen.add(grid)
+
+        size = [extent[i]/grid[i] if extent[i] > 0 else min_size for i in range(dims)]
+        cost, migration_rate, most_crowded = grid_cost(particles, low, size, grid, abs_velocity, migrate_cost)
+        if best is None or cost < best[0]:
+            best = (cost, list(grid), low, size, migration_rate, most_crowded)
+    return best
+
+
+def plan_ranks(particles, corner, size, grid, ranks):
+    #slabs along axis 0, cut where the running particle count passes each rank's share
+    ranks = max(1, min(ranks, grid[0]))
+    columns = [0]*grid[0]
+    for p in particles:
+        columns[volume_of(p[5], corner, size, grid)[0]] += 1
+
+    cuts = []
+    running = 0
+    for column, count in enumerate(columns[:-1]):
+        running += count
+        #every slab keeps at least one column
+        left = grid[0]-(column+1)
+        needed = ranks-1-len(cuts)
+        if needed > 0 and (running >= len(particles)*(len(cuts)+1)/ranks or left == needed):
+            cuts.append(column+1)
+
+    edges = [0]+cuts+[grid[0]]
+    loads = [sum(columns[edges[r]:edges[r+1]]) for r in range(len(edges)-1)]
+    return cuts, loads
+
+
+def plan(scenario, velocity = None, ranks = 1, shard = 2, migrate_cost = 1.0):
+    particles = scenario["particles"]
+    dims = len(particles[0][5])
+    if velocity is None:
+        velocity = scenario.get("velocity", {"samples": [p[6] for p in particles]})
+    abs_velocity = expected_abs_velocity(velocity, dims)
+
+    cost, grid, corner, size, migration_rate, most_crowded = plan_grid(particles, dims, abs_velocity, migrate_cost)
+    cuts, loads = plan_ranks(particles, corner, size, grid, ranks)
+
+    #a particle takes at least min(s_i)/max|v| to cross a volume, syncs should be well inside that
+    fastest = max(math.sqrt(sum(v*v for v in p[6])) for p in particles)
+    sync_interval = 0.1*min(size)/fastest if fastest > 0 else 1.0
+
+    out = dict(scenario)
+    out.pop("velocity", None)
+    out.update({
+        "dims": dims,
+        "grid_size": grid,
+        "corner": corner,
+        "volume_size": size,
+        "shard_size": [min(shard, g) for g in grid],
+        "open_edges": True,
+        "ranks": len(loads),
+        "rank_cuts": cuts,
+        "sync_interval": sync_interval,
+        "plan": {
+            "cost": cost,
+            "expected_migration_rate": migration_rate,
+            "most_crowded_volume": most_crowded,
+            "rank_particles": loads,
+        },
+    })
+    return out
+
+
+def dump_scenario(scenario):
+    #one line per key, and one line per particle, so a planned scenario still reads like the particle lists in the tests
+    lines = []
+    for key, value in scenario.items():
+        if key == "particles":
+            lines.append(' "particles": [\n' + ',\n'.join('  '+json.dumps(p) for p in value) + '\n ]')
+        else:
+            lines.append(' '+json.dumps(key)+': '+json.dumps(value))
+    return '{\n' + ',\n'.join(lines) + '\n}\n'
+
+
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser(description="Pick volume extents and a worker split for a scenario, and write a scenario that is ready to run.")
+    parser.add_argument("scenario", help="json with a list of particles, [last_updated, id, species, mass, radius, [position], [velocity]], and optionally end_time")
+    parser.add_argument("velocity", nargs="?", help="json with the expected velocity distribution, {\"mean\":[...], \"sigma\":[...]} or {\"samples\":[[...], ...]}, the particles' own velocities by default")
+    parser.add_argument("-r", "--ranks", type=int, default=1, help="number of worker processes")
+    parser.add_argument("-s", "--shard", type=int, default=2, help="volumes per collider shard along each axis")
+    parser.add_argument("-m", "--migrate-cost", type=float, default=1.0, help="cost of moving one particle between volumes, in pair checks")
+    parser.add_argument("-o", "--out", help="where to write the planned scenario, stdout by default")
+    args = parser.parse_args()
+
+    with open(args.scenario) as scenario_file:
+        scenario = json.load(scenario_file)
+    velocity = None
+    if args.velocity:
+        with open(args.velocity) as velocity_file:
+            velocity = json.load(velocity_file)
+
+    planned = plan(scenario, velocity, args.ranks, args.shard, args.migrate_cost)
+    if args.out:
+        with open(args.out, "w") as out_file:
+            out_file.write(dump_scenario(planned))
+    else:
+        print(dump_scenario(planned), end='')
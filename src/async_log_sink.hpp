@@ -0,0 +1,287 @@
+#ifndef __ASYNC_LOG_SINK_HPP__
+#define __ASYNC_LOG_SINK_HPP__
+
+#include <cstddef>
+#include <atomic>
+#include <vector>
+#include <memory>
+#include <string>
+#include <thread>
+#include <chrono>
+#include <mutex>
+#include <ostream>
+#include <fstream>
+#include <iostream>
+#include <streambuf>
+#include <condition_variable>
+
+namespace tps{
+
+/*
+    A fixed size single producer single consumer queue.
+    push is only called from one thread and pop only from one other thread, neither of them ever takes a lock.
+*/
+template<typename T>
+struct spsc_ring{
+    std::vector<T> slots;
+    std::atomic<std::size_t> head{0};       //next slot to pop, only written by the consumer
+    std::atomic<std::size_t> tail{0};       //next slot to push, only written by the producer
+
+    explicit spsc_ring(std::size_t capacity) : slots(capacity+1) {}
+
+    bool push(T value){
+        const std::size_t at = tail.load(std::memory_order_relaxed);
+        const std::size_t next = (at+1) % slots.size();
+        if(next == head.load(std::memory_order_acquire)){
+            return false;
+        }
+        slots[at] = std::move(value);
+        tail.store(next, std::memory_order_release);
+        return true;
+    }
+
+    bool pop(T& value){
+        const std::size_t at = head.load(std::memory_order_relaxed);
+        if(at == tail.load(std::memory_order_acquire)){
+            return false;
+        }
+        value = std::move(slots[at]);
+        head.store((at+1) % slots.size(), std::memory_order_release);
+        return true;
+    }
+};
+
+/*
+    An ostream for the loggers that never waits on the disk, unless it is told to.
+    The loggers format into a chunk of memory on the simulation thread, full chunks are handed to a writer thread through one ring,
+    and the writer hands them back empty through another, so after a short warm up nothing is allocated either.
+    If the writer falls behind and every chunk is in flight, a new chunk is made, up to max_chunks, 64 MB with the defaults.
+    Past that whole records are dropped, counted in dropped_records and dropped_bytes, and the run carries on.
+    With drop_when_full false nothing is dropped, the run blocks instead until the writer hands a chunk back, and stalls counts how often it did.
+
+    A chunk is only ever handed over up to the end of its last whole record, a line, and the unfinished one is carried over into the next chunk.
+    So what is dropped is always whole records, and every line in the file is one the loggers wrote, never a piece of one.
+    A record longer than a chunk grows the chunk to fit it.
+
+    Nothing is written until a chunk fills up or the sink is closed, flushes and std::endl do not force a write.
+    Closing hands over the last chunk and waits for the writer to finish what is queued, which is never more than max_chunks chunks.
+    If anything was dropped, closing says so on std::cerr.
+*/
+class async_log_sink : public std::ostream{
+    struct chunk{
+        std::vector<char> bytes;
+        std::size_t used{0};
+    };
+
+    class chunk_buffer : public std::streambuf{
+        async_log_sink& sink;
+    public:
+        explicit chunk_buffer(async_log_sink& sink) : sink(sink) {}
+
+        void point_at(chunk* c){
+            if(c){
+                setp(c->bytes.data(), c->bytes.data()+c->bytes.size());
+            }else{
+                setp(nullptr, nullptr);
+            }
+        }
+
+        std::size_t written() const {
+            return pptr()-pbase();
+        }
+
+        //the same chunk again, with the first used bytes already written
+        void point_at(chunk* c, std::size_t used){
+            point_at(c);
+            pbump((int)used);
+        }
+
+    protected:
+        int_type overflow(int_type ch) override {
+            if(traits_type::eq_int_type(ch, traits_type::eof())){
+                return traits_type::not_eof(ch);
+            }
+            const char c = traits_type::to_char_type(ch);
+            xsputn(&c, 1);
+            return ch;
+        }
+
+        std::streamsize xsputn(const char* s, std::streamsize n) override {
+            std::streamsize done = 0;
+            while(done < n){
+                if(sink.dropping){
+                    //the start of this record is gone, so the rest of it goes too, up to and with its newline
+                    const char* end = traits_type::find(s+done, n-done, '\n');
+                    const std::streamsize skipped = end ? end-(s+done)+1 : n-done;
+                    sink.dropped_bytes += skipped;
+                    done += skipped;
+                    sink.dropping = !end;
+                    continue;
+                }
+                if(pptr() == epptr()){
+                    //this either makes room, or starts dropping the record
+                    sink.hand_over();
+                    continue;
+                }
+                const std::streamsize room = std::min<std::streamsize>(epptr()-pptr(), n-done);
+                traits_type::copy(pptr(), s+done, room);
+                pbump(room);
+                done += room;
+            }
+            return n;
+        }
+    };
+
+    std::ofstream file;
+    std::size_t chunk_size;
+    std::size_t max_chunks;
+    bool drop_when_full;
+
+    /* only touched by the simulation thread */
+    std::vector<std::unique_ptr<chunk>> chunks{};
+    chunk* current{nullptr};
+    chunk_buffer buffer;
+    std::vector<char> carry{};          //the unfinished record at the end of a chunk that is being handed over
+    bool dropping{false};               //the record being written lost its start, so the rest of it is dropped too
+
+    spsc_ring<chunk*> full;
+    spsc_ring<chunk*> empty;
+
+    std::atomic<bool> closing{false};
+    std::mutex wake_mutex{};
+    std::condition_variable wake{};
+    std::mutex returned_mutex{};
+    std::condition_variable returned{};
+    std::thread writer{};
+
+    //an empty chunk, or nothing if there are max_chunks already and drop_when_full, without it this waits on the writer for one
+    chunk* acquire(){
+        chunk* c = nullptr;
+        if(empty.pop(c)){
+            return c;
+        }
+        if(chunks.size() < max_chunks){
+            chunks.push_back(std::make_unique<chunk>());
+            chunks.back()->bytes.resize(chunk_size);
+            return chunks.back().get();
+        }
+        if(drop_when_full){
+            return nullptr;
+        }
+        stalls++;
+        while(!empty.pop(c)){
+            wake.notify_one();
+            std::unique_lock<std::mutex> lock(returned_mutex);
+            //the writer does not take the lock to notify either, the timeout covers a missed wake up
+            returned.wait_for(lock, std::chrono::milliseconds(1));
+        }
+        return c;
+    }
+
+    //pass the whole records in the current chunk to the writer and carry on in an empty one, or drop the record being written if none can be had
+    void hand_over(){
+        if(current){
+            const std::size_t written = buffer.written();
+            std::size_t records_end = written;
+            while(records_end && current->bytes[records_end-1] != '\n'){
+                records_end--;
+            }
+            if(records_end == 0 && written){
+                //one record fills the whole chunk, make room for the rest of it here, so it is never split
+                current->bytes.resize(2*current->bytes.size());
+                buffer.point_at(current, written);
+                return;
+            }
+            if(written == 0){
+                buffer.point_at(current);
+                return;
+            }
+            carry.assign(current->bytes.begin()+records_end, current->bytes.begin()+written);
+            current->used = records_end;
+            //full has room for every chunk there is, so this never fails
+            full.push(current);
+            wake.notify_one();
+        }else{
+            carry.clear();
+        }
+        current = acquire();
+        if(!current){
+            buffer.point_at(nullptr);
+            dropped_records++;
+            dropped_bytes += carry.size();
+            dropping = true;
+            return;
+        }
+        if(current->bytes.size() < carry.size()){
+            current->bytes.resize(carry.size());
+        }
+        std::copy(carry.begin(), carry.end(), current->bytes.begin());
+        buffer.point_at(current, carry.size());
+    }
+
+    void write_loop(){
+        chunk* c = nullptr;
+        while(true){
+            //read closing before draining, anything pushed before close() set it is then always drained
+            const bool last = closing.load(std::memory_order_acquire);
+            while(full.pop(c)){
+                file.write(c->bytes.data(), c->used);
+                c->used = 0;
+                empty.push(c);
+                returned.notify_one();
+            }
+            if(last){
+                break;
+            }
+            std::unique_lock<std::mutex> lock(wake_mutex);
+            //the producer does not take the lock to notify, so a wake up can be missed, the timeout bounds how late that makes a write
+            wake.wait_for(lock, std::chrono::milliseconds(10));
+        }
+        file.flush();
+    }
+
+public:
+    std::size_t stalls{0};
+    std::size_t dropped_records{0};
+    std::size_t dropped_bytes{0};
+
+    explicit async_log_sink(const std::string& path, std::size_t chunk_size = 1 << 16, std::size_t max_chunks = 1024, bool drop_when_full = true) :
+        std::ostream(nullptr), file(path), chunk_size(chunk_size), max_chunks(max_chunks), drop_when_full(drop_when_full), buffer(*this), full(max_chunks), empty(max_chunks) {
+        rdbuf(&buffer);
+        current = acquire();
+        buffer.point_at(current);
+        writer = std::thread([this]{ write_loop(); });
+    }
+
+    async_log_sink(const async_log_sink&) = delete;
+    async_log_sink& operator=(const async_log_sink&) = delete;
+
+    ~async_log_sink() override {
+        close();
+    }
+
+    void close(){
+        if(!writer.joinable()){
+            return;
+        }
+        //everything that is left goes, whole records or not
+        if(current){
+            current->used = buffer.written();
+            if(current->used){
+                full.push(current);
+            }
+            current = nullptr;
+        }
+        closing.store(true, std::memory_order_release);
+        wake.notify_one();
+        writer.join();
+        rdbuf(nullptr);
+        file.close();
+        if(dropped_bytes){
+            std::cerr << "async_log_sink: dropped " << dropped_records << " records, " << dropped_bytes << " bytes, the writer could not keep up\n";
+        }
+    }
+};
+
+}
+#endif /* __ASYNC_LOG_SINK_HPP__ */
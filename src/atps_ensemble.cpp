@@ -0,0 +1,58 @@
+/*
+    Runs an ensemble file, see load_ensemble in ensemble_runner.hpp, and writes every case's results to one json file.
+
+        bin/atps_ensemble.out ensemble.json [results.json] [threads]
+
+    The results go to simulation_results/ensemble_results.json by default, threads overrides the file's.
+    Build with -DATPS_DIMS=3 for 3d scenarios, like atps_native.
+*/
+
+#include "./ensemble_runner.hpp"
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <exception>
+
+#ifndef ATPS_DIMS
+#define ATPS_DIMS 2
+#endif
+
+using namespace tps;
+
+using TIME = double;
+using REAL = double;
+constexpr std::size_t DIMS = ATPS_DIMS;
+
+int main(int argc, char ** argv) {
+    if(argc < 2){
+        std::cerr << "usage: " << argv[0] << " ensemble.json [results.json] [threads]\n";
+        return 1;
+    }
+    const std::string out_path = argc > 2 ? argv[2] : "./simulation_results/ensemble_results.json";
+    try{
+        auto ens = load_ensemble<TIME, REAL, DIMS>(std::string(argv[1]));
+        if(argc > 3){
+            ens.threads = std::stoul(argv[3]);
+        }
+        std::cout << ens.cases.size() << " cases on " << ens.threads << " threads\n";
+
+        const auto results = ens.run();
+        std::size_t failed = 0;
+        for(const auto& result : results){
+            std::cout << result.name << ": " << (result.error.empty() ? "done" : result.error) << " in " << result.wall_seconds << "s\n";
+            failed += !result.error.empty();
+        }
+
+        std::ofstream out(out_path);
+        if(!out){
+            std::cerr << "could not write " << out_path << "\n";
+            return 1;
+        }
+        out << ensemble_results_json<TIME, REAL, DIMS>(results).dump(1) << "\n";
+        return failed ? 2 : 0;
+    }catch(const std::exception& e){
+        std::cerr << e.what() << "\n";
+        return 1;
+    }
+}
@@ -0,0 +1,168 @@
+/*
+    A plain C interface to a run, built as a shared library for atps_native.py to load with ctypes.
+    One handle is one scenario running in this process, stepped from outside, with no logging at all.
+
+    The snapshot arrays are handed out as pointers into the library, so reading them from python copies nothing.
+    They stay good until the next atps_snapshot or atps_close on the same handle.
+    Build with -DATPS_DIMS=3 for a 3d library, one library only runs scenarios of its own dimension.
+*/
+
+//Cadmium Simulator headers
+#include <cadmium/modeling/dynamic_model.hpp>
+#include <cadmium/modeling/dynamic_model_translator.hpp>
+#include <cadmium/engine/pdevs_dynamic_runner.hpp>
+#include <cadmium/logger/common_loggers.hpp>
+
+#include "./grid_topology.hpp"
+#include "./scenario_loader.hpp"
+#include "./snapshot_model.hpp"
+
+#include <cmath>
+#include <limits>
+#include <memory>
+#include <string>
+#include <sstream>
+#include <exception>
+
+#ifndef ATPS_DIMS
+#define ATPS_DIMS 2
+#endif
+
+using namespace cadmium;
+using namespace tps;
+
+using TIME = double;
+using REAL = double;
+constexpr std::size_t DIMS = ATPS_DIMS;
+
+namespace{
+
+struct native_run{
+    std::shared_ptr<particle_snapshot<TIME, REAL, DIMS>> snapshot{std::make_shared<particle_snapshot<TIME, REAL, DIMS>>()};
+    std::shared_ptr<dynamic::modeling::coupled<TIME>> top{};
+    std::unique_ptr<dynamic::engine::runner<TIME, logger::not_logger>> runner{};
+    TIME time{0};
+    TIME next{0};
+
+    explicit native_run(const scenario<TIME, REAL, DIMS>& sc){
+        auto grid = sc.make_grid();
+        add_snapshot<TIME, REAL, DIMS>(grid, snapshot);
+
+        top = std::make_shared<dynamic::modeling::coupled<TIME>>(
+            "TOP", grid.models, dynamic::modeling::Ports{}, dynamic::modeling::Ports{}, dynamic::modeling::EICs{}, dynamic::modeling::EOCs{}, grid.ics
+        );
+        runner = std::make_unique<dynamic::engine::runner<TIME, logger::not_logger>>(top, TIME{0});
+        //the volumes only announce what they hold in their first transition, so the run starts with time 0 done
+        run_until(TIME{0});
+    }
+
+    //the runner stops short of t, this runs the events at t too, so a snapshot at t sees them
+    TIME run_until(TIME t){
+        next = runner->run_until(std::nextafter(t, std::numeric_limits<TIME>::infinity()));
+        time = t;
+        return next;
+    }
+};
+
+//the last thing that went wrong, for atps_error, ctypes has no way to see a c++ exception
+thread_local std::string last_error{};
+
+template<typename F>
+auto guarded(F&& f, decltype(f()) failed) -> decltype(f()) {
+    try{
+        return f();
+    }catch(const std::exception& e){
+        last_error = e.what();
+    }catch(...){
+        last_error = "unknown error";
+    }
+    return failed;
+}
+
+}
+
+extern "C"{
+
+const char* atps_error(){
+    return last_error.c_str();
+}
+
+std::size_t atps_dims(){
+    return DIMS;
+}
+
+//a scenario json file, as written by atps_plan_domain.py, or nullptr if it could not be loaded
+void* atps_open(const char* path){
+    return guarded([&]() -> void* {
+        return new native_run(load_scenario<TIME, REAL, DIMS>(std::string(path)));
+    }, nullptr);
+}
+
+//the same, from the json text itself
+void* atps_open_json(const char* text){
+    return guarded([&]() -> void* {
+        std::istringstream is{std::string(text)};
+        return new native_run(load_scenario<TIME, REAL, DIMS>(is));
+    }, nullptr);
+}
+
+void atps_close(void* handle){
+    delete static_cast<native_run*>(handle);
+}
+
+//runs every event up to and including t, and returns when the next one is, infinity once nothing is left to happen, or nan on an error
+double atps_run_until(void* handle, double t){
+    auto& run = *static_cast<native_run*>(handle);
+    return guarded([&]{ return run.run_until(t); }, std::nan(""));
+}
+
+//runs the next event, and everything at the same time as it, and returns when the one after is
+double atps_step(void* handle){
+    auto& run = *static_cast<native_run*>(handle);
+    if(std::isinf(run.next)){
+        return run.next;
+    }
+    return guarded([&]{ return run.run_until(run.next); }, std::nan(""));
+}
+
+double atps_time(void* handle){
+    return static_cast<native_run*>(handle)->time;
+}
+
+double atps_next(void* handle){
+    return static_cast<native_run*>(handle)->next;
+}
+
+//fills the snapshot arrays with every particle where it is at atps_time, and returns how many there are
+std::size_t atps_snapshot(void* handle){
+    auto& run = *static_cast<native_run*>(handle);
+    run.snapshot->take(run.time);
+    return run.snapshot->size();
+}
+
+const std::size_t* atps_ids(void* handle){
+    return static_cast<native_run*>(handle)->snapshot->id.data();
+}
+
+const std::size_t* atps_species(void* handle){
+    return static_cast<native_run*>(handle)->snapshot->species.data();
+}
+
+const double* atps_mass(void* handle){
+    return static_cast<native_run*>(handle)->snapshot->mass.data();
+}
+
+const double* atps_radius(void* handle){
+    return static_cast<native_run*>(handle)->snapshot->radius.data();
+}
+
+//count*dims values, one row per particle
+const double* atps_positions(void* handle){
+    return static_cast<native_run*>(handle)->snapshot->position.data();
+}
+
+const double* atps_velocities(void* handle){
+    return static_cast<native_run*>(handle)->snapshot->velocity.data();
+}
+
+}
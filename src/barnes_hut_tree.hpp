@@ -0,0 +1,235 @@
+#ifndef __BARNES_HUT_TREE_HPP__
+#define __BARNES_HUT_TREE_HPP__
+
+#include <cstddef>
+#include <array>
+#include <vector>
+#include <cmath>
+#include <limits>
+#include <algorithm>
+
+namespace tps{
+
+/*
+    A 2^DIMS tree over point charges, for working out long range fields in O(N log N).
+    Each node keeps the total charge of everything under it, and the point its charges are centred on.
+    A node that looks smaller than theta from where the field is wanted counts as one charge at that point, a bigger one is opened.
+    theta = 0 opens every node, which is the exact O(N^2) sum.
+
+    With charges of both signs the centre is weighted by |q|, so a node that is close to neutral is still placed where its charges are,
+    but only its net charge is used, a mostly neutral node far away is treated as if it had no field at all.
+*/
+template<typename REAL, std::size_t DIMS>
+struct barnes_hut_tree{
+    static constexpr std::size_t children = std::size_t{1} << DIMS;
+
+    struct body{
+        std::array<REAL, DIMS> position;
+        REAL charge;
+    };
+
+    struct node{
+        std::array<REAL, DIMS> centre{};
+        REAL half{0};
+        REAL charge{0};
+        REAL weight{0};                         //sum of |charge|
+        std::array<REAL, DIMS> charge_centre{};
+        std::size_t begin{0};                   //the bodies under this node are order[begin, end)
+        std::size_t end{0};
+        std::size_t first_child{0};             //0 for a leaf, the root is never anyone's child
+    };
+
+    std::vector<body> bodies{};
+    std::vector<std::size_t> order{};
+    std::vector<std::size_t> rank{};            //where each body ended up in order
+    std::vector<node> nodes{};
+
+    //a node with this many bodies or fewer is not split, and neither is anything this deep, so bodies on top of each other end up in one leaf
+    std::size_t leaf_size{4};
+    std::size_t max_depth{48};
+
+    //scratch space for build and field, kept so rebuilding every sweep does not go back to the heap
+    std::vector<std::size_t> scratch{};
+    std::vector<unsigned> codes{};
+    mutable std::vector<std::size_t> walk{};
+
+    void clear(){
+        bodies.clear();
+        order.clear();
+        nodes.clear();
+    }
+
+    void build(){
+        nodes.clear();
+        order.resize(bodies.size());
+        for(std::size_t i = 0; i<order.size(); i++){
+            order[i] = i;
+        }
+        if(bodies.empty()){
+            return;
+        }
+
+        std::array<REAL, DIMS> low{};
+        std::array<REAL, DIMS> high{};
+        low.fill(std::numeric_limits<REAL>::infinity());
+        high.fill(-std::numeric_limits<REAL>::infinity());
+        for(const auto& b : bodies){
+            for(std::size_t i = 0; i<DIMS; i++){
+                low[i] = std::min(low[i], b.position[i]);
+                high[i] = std::max(high[i], b.position[i]);
+            }
+        }
+        node root{};
+        for(std::size_t i = 0; i<DIMS; i++){
+            root.centre[i] = (low[i]+high[i])/2;
+            root.half = std::max(root.half, (high[i]-low[i])/2);
+        }
+        root.end = bodies.size();
+        nodes.push_back(root);
+        scratch.resize(bodies.size());
+        codes.resize(bodies.size());
+        split(0, 0);
+        rank.resize(bodies.size());
+        for(std::size_t k = 0; k<order.size(); k++){
+            rank[order[k]] = k;
+        }
+    }
+
+    //adds q_j*(from-at)/(|from-at|^2+softening^2)^(3/2) to out, the field of one charge
+    static void add_field(std::array<REAL, DIMS>& out, const std::array<REAL, DIMS>& at, const std::array<REAL, DIMS>& from, REAL q, REAL softening){
+        std::array<REAL, DIMS> d{};
+        REAL r2 = softening*softening;
+        for(std::size_t i = 0; i<DIMS; i++){
+            d[i] = from[i]-at[i];
+            r2 += d[i]*d[i];
+        }
+        if(r2 <= REAL{0}){
+            return;
+        }
+        const REAL s = q/(r2*std::sqrt(r2));
+        for(std::size_t i = 0; i<DIMS; i++){
+            out[i] += s*d[i];
+        }
+    }
+
+    /*
+        sum over every body but the ones in skip of q_j*(x_j-at)/(|x_j-at|^2+softening^2)^(3/2)
+        multiply by the coupling and the charge at at to get a force
+        a node with a skipped body under it is always opened, so the skipped ones are left out exactly, keep skip short
+    */
+    std::array<REAL, DIMS> field(const std::array<REAL, DIMS>& at, const std::vector<std::size_t>& skip, REAL theta, REAL softening) const {
+        std::array<REAL, DIMS> out{};
+        if(nodes.empty()){
+            return out;
+        }
+        auto skipped = [&](std::size_t b){
+            return std::find(skip.begin(), skip.end(), b) != skip.end();
+        };
+        auto holds_skipped = [&](const node& n){
+            for(const auto b : skip){
+                if(rank[b] >= n.begin && rank[b] < n.end){
+                    return true;
+                }
+            }
+            return false;
+        };
+
+        auto& stack = walk;
+        stack.assign(1, 0);
+        while(stack.size()){
+            const node& n = nodes[stack.back()];
+            stack.pop_back();
+            if(n.weight == REAL{0}){
+                continue;
+            }
+            if(!n.first_child){
+                for(std::size_t k = n.begin; k<n.end; k++){
+                    if(!skipped(order[k])){
+                        add_field(out, at, bodies[order[k]].position, bodies[order[k]].charge, softening);
+                    }
+                }
+                continue;
+            }
+            REAL dist2 = 0;
+            for(std::size_t i = 0; i<DIMS; i++){
+                dist2 += (n.charge_centre[i]-at[i])*(n.charge_centre[i]-at[i]);
+            }
+            const REAL width = 2*n.half;
+            if(width*width < theta*theta*dist2 && !holds_skipped(n)){
+                add_field(out, at, n.charge_centre, n.charge, softening);
+            }else{
+                for(std::size_t c = 0; c<children; c++){
+                    stack.push_back(n.first_child+c);
+                }
+            }
+        }
+        return out;
+    }
+
+private:
+    void split(std::size_t n, std::size_t depth){
+        //nodes can grow under us, so n is only ever used as an index
+        {
+            node& nd = nodes[n];
+            for(std::size_t k = nd.begin; k<nd.end; k++){
+                const body& b = bodies[order[k]];
+                nd.charge += b.charge;
+                nd.weight += std::abs(b.charge);
+                for(std::size_t i = 0; i<DIMS; i++){
+                    nd.charge_centre[i] += std::abs(b.charge)*b.position[i];
+                }
+            }
+            for(std::size_t i = 0; i<DIMS; i++){
+                nd.charge_centre[i] = nd.weight > REAL{0} ? nd.charge_centre[i]/nd.weight : nd.centre[i];
+            }
+            if(nd.end-nd.begin <= leaf_size || depth >= max_depth){
+                return;
+            }
+        }
+
+        const std::size_t begin = nodes[n].begin;
+        const std::size_t end = nodes[n].end;
+        const auto centre = nodes[n].centre;
+        const REAL half = nodes[n].half/2;
+
+        //counting sort of this node's bodies by which child they fall in
+        std::array<std::size_t, children+1> starts{};
+        for(std::size_t k = begin; k<end; k++){
+            unsigned code = 0;
+            for(std::size_t i = 0; i<DIMS; i++){
+                code |= (bodies[order[k]].position[i] >= centre[i]) << i;
+            }
+            codes[k] = code;
+            starts[code+1]++;
+        }
+        for(std::size_t c = 0; c<children; c++){
+            starts[c+1] += starts[c];
+        }
+        auto fill = starts;
+        for(std::size_t k = begin; k<end; k++){
+            scratch[begin+fill[codes[k]]++] = order[k];
+        }
+        std::copy(scratch.begin()+begin, scratch.begin()+end, order.begin()+begin);
+
+        const std::size_t first = nodes.size();
+        nodes[n].first_child = first;
+        for(std::size_t c = 0; c<children; c++){
+            node child{};
+            for(std::size_t i = 0; i<DIMS; i++){
+                child.centre[i] = centre[i]+((c >> i) & 1 ? half : -half);
+            }
+            child.half = half;
+            child.begin = begin+starts[c];
+            child.end = begin+starts[c+1];
+            nodes.push_back(child);
+        }
+        for(std::size_t c = 0; c<children; c++){
+            if(nodes[first+c].end > nodes[first+c].begin){
+                split(first+c, depth+1);
+            }
+        }
+    }
+};
+
+}
+#endif /* __BARNES_HUT_TREE_HPP__ */
@@ -6,15 +6,25 @@
 #include <cadmium/modeling/message_bag.hpp>
 
 #include <map>
+#include <set>
 #include <vector>
 #include <utility>
 #include <tuple>
 #include <algorithm>
+#include <memory>
 
 #include "./particle.hpp"
 #include "./particle_delta_message.hpp"
 #include "./particle_announcement_message.hpp"
+#include "./contact_region_message.hpp"
 #include "./blocking_collider_rules.hpp"
+#include "./species_interactions.hpp"
+#include "./volume_neighbours.hpp"
+#include "./morton_order.hpp"
+#include "./periodic_boundary.hpp"
+#include "./coalescing_error.hpp"
+#include "./node_pool.hpp"
+#include "./thread_pool.hpp"
 
 namespace tps{
 
@@ -22,6 +32,7 @@ template<typename TIME, typename REAL, std::size_t DIMS>
 struct blocking_defs{
 
     struct particle_announcement    : public cadmium::in_port<particle_announcement_message<TIME, REAL, DIMS>> {};
+    struct contact_region           : public cadmium::in_port<contact_region_message<DIMS>> {};
 
     struct particle_delta           : public cadmium::out_port<particle_delta_message<TIME, REAL, DIMS>> {};
 
@@ -29,21 +40,82 @@ struct blocking_defs{
 
 template<typename TIME, typename REAL, std::size_t DIMS>
 struct blocking_collider_model{
+    struct settings_type{
+        /*
+            The volumes this collider is responsible for. Any other volume it hears from is treated as a halo volume:
+            its particles are checked against the owned volumes, but no hit is ever stored against it.
+            A hit is stored against the volume holding the lower particle id, so each pair has exactly one owner across every shard.
+            Leave this empty to own every volume, which is the single collider case.
+        */
+        std::set<std::array<long, DIMS>> owned_volumes{};
+
+        //every collision due within this long after the next one is held back and fired in the same transition
+        //each is still worked out at its own predicted time, only its dv lands late, see coalescing_error
+        TIME coalesce_tolerance{0};
+
+        //axes that wrap around, pairs across the seam are checked with the nearest copy of the far particle
+        periodic_extent<REAL, DIMS> periodic{};
+
+        //how many threads look for hits when many volumes change at once, counting the simulation thread
+        //the hits found are the same for any number of threads
+        std::size_t threads{1};
+
+        //how each pair of species meets, pairs that do not collide are skipped before their hit time is worked out
+        species_table<TIME, REAL> species{};
+    };
+    settings_type settings;
+
+    //a hit one dirty volume's scan found, for the volume that would store it
+    struct hit_candidate{
+        std::array<long, DIMS> volume_id;
+        std::size_t lhs;
+        std::size_t rhs;
+        std::array<long, DIMS> rhs_volume_id;
+        TIME time;
+    };
+
     struct state_type{
         TIME global_time{0};
         std::vector<particle_delta_message<TIME, REAL, DIMS>> pending_deltas{};
 
+        //kept in morton order, so the lookups of a volume and its neighbours walk mostly the same nodes
         std::map<std::array<long, DIMS>, std::tuple<
             const std::map<std::size_t, particle<TIME, REAL, DIMS>>*, //"copy" of the state of the volume
             std::size_t, //lhs, in this volume, or -1 for no collision
-            std::size_t, //rhs, not always in this volume and higher than lhs
+            std::size_t, //rhs, not always in this volume and higher than lhs, unless it is held
             std::array<long, DIMS>, //the volume id that rhs is in
-            TIME //the time of the collision
-        >> volumes{};
+            TIME, //the time of the collision
+            const std::set<std::size_t>*, //the particles in the volume that are not resting, nullptr if all of them should be treated as moving
+            const std::set<std::size_t>* //the particles in the volume that only this process can see, nullptr if there are none
+        >, morton_less<DIMS>> volumes{};
+
+        /*
+            Every finite hit in volumes, ordered by time, so the next one is always at the front.
+            A volume's hit time in volumes is also its key in here, which is how a hit gets found again to move or drop it.
+        */
+        std::set<std::pair<TIME, std::array<long, DIMS>>> hit_queue{};
+        node_pool<std::set<std::pair<TIME, std::array<long, DIMS>>>> hit_nodes{};
 
         TIME next_internal_time{};
 
+        /* how much accuracy coalescing has cost so far, this stays empty unless settings.coalesce_tolerance is set */
+        coalescing_error<TIME, REAL> coalesced{};
+
+        //volumes a soft_contact_model has taken over, no pair with both particles in them is looked at here until one is given back
+        std::set<std::array<long, DIMS>> soft_volumes{};
+
+        //scratch space for external_transition, kept here so it does not go back to the heap every transition
+        std::vector<std::array<long, DIMS>> dirty_volumes{};
+        std::vector<std::vector<hit_candidate>> candidates{};
+        std::vector<std::size_t> scan_order{};
+
+        //made the first time it is needed, shared by copies of the model
+        std::shared_ptr<thread_pool> pool{};
+
         friend std::ostream& operator<<(std::ostream& os, const state_type& state) {
+            if(state.coalesced.coalesced_events){
+                os << "{\"coalescing\":" << state.coalesced << "}";
+            }
             return os;
         }
 
@@ -52,7 +124,8 @@ struct blocking_collider_model{
 
 
     using input_ports = std::tuple<
-        typename blocking_defs<TIME, REAL, DIMS>::particle_announcement
+        typename blocking_defs<TIME, REAL, DIMS>::particle_announcement,
+        typename blocking_defs<TIME, REAL, DIMS>::contact_region
     >;
 
     using output_ports = std::tuple<
@@ -60,13 +133,150 @@ struct blocking_collider_model{
     >;
 
     blocking_collider_model<TIME, REAL, DIMS>(){};
+    blocking_collider_model<TIME, REAL, DIMS>(settings_type settings) : settings(std::move(settings)) {};
+
+    //calls f with each particle of a volume in volumes that is not resting
+    template<typename V, typename F>
+    static void for_each_awake(const V& v, F&& f){
+        const auto* particles = std::get<0>(v);
+        const auto* awake = std::get<5>(v);
+        if(!awake){
+            for(const auto& kv : *particles){
+                f(kv.second);
+            }
+            return;
+        }
+        for(const auto id : *awake){
+            auto it = particles->find(id);
+            if(it != particles->end()){
+                f(it->second);
+            }
+        }
+    }
+
+    bool owns(const std::array<long, DIMS>& volume_id) const {
+        return settings.owned_volumes.empty() || settings.owned_volumes.count(volume_id);
+    }
+
+    bool soft(const std::array<long, DIMS>& volume_id) const {
+        return state.soft_volumes.size() && state.soft_volumes.count(volume_id);
+    }
+
+    //change the hit time of volume k, and keep hit_queue in step with it
+    void set_hit_time(const std::array<long, DIMS>& k, TIME& hit_time, TIME new_time){
+        typename decltype(state.hit_queue)::node_type node{};
+        if(hit_time != std::numeric_limits<TIME>::infinity()){
+            node = state.hit_queue.extract({hit_time, k});
+        }
+        hit_time = new_time;
+        if(new_time == std::numeric_limits<TIME>::infinity()){
+            if(node){
+                state.hit_nodes.spare.push_back(std::move(node));
+            }
+            return;
+        }
+        if(!node){
+            node = state.hit_nodes.take();
+        }
+        if(node){
+            node.value() = {new_time, k};
+            state.hit_queue.insert(std::move(node));
+        }else{
+            state.hit_nodes.allocations++;
+            state.hit_queue.insert({new_time, k});
+        }
+    }
+
+    //the time of the next hit, or if coalescing, of the last hit due within the tolerance of it
+    void update_next_internal_time(){
+        state.next_internal_time = std::numeric_limits<TIME>::infinity();
+        if(state.hit_queue.size()){
+            state.next_internal_time = state.hit_queue.begin()->first;
+            if(settings.coalesce_tolerance > TIME{0}){
+                const TIME first = state.next_internal_time;
+                for(auto it = state.hit_queue.begin(); it != state.hit_queue.end() && it->first <= first+settings.coalesce_tolerance; it++){
+                    state.next_internal_time = it->first;
+                }
+            }
+        }
+    }
+
+    /*
+        Looks for the next hit of every pair with a particle in volume lk, and puts the soonest one for each volume that would store it in found.
+        Of two hits at the same time the one found first is kept, like the rest of the collider does.
+        Nothing in the state is changed, so any number of these can run at once.
+    */
+    void scan(const std::array<long, DIMS>& lk, std::vector<hit_candidate>& found) const {
+        found.clear();
+        const auto& lv = state.volumes.at(lk);
+
+        auto keep = [&](const std::array<long, DIMS>& k, std::size_t lhs, std::size_t rhs, const std::array<long, DIMS>& rk, TIME tt){
+            for(auto& hit : found){
+                if(hit.volume_id == k){
+                    if(tt < hit.time){
+                        hit = {k, lhs, rhs, rk, tt};
+                    }
+                    return;
+                }
+            }
+            found.push_back({k, lhs, rhs, rk, tt});
+        };
+
+        for_each_neighbour(lk, settings.periodic.grid, [&](const std::array<long, DIMS>& rk, const std::array<long, DIMS>& wraps){ //for each volume near enough the first or is the first
+            auto rkv = state.volumes.find(rk);
+            if(rkv == state.volumes.end() || !(owns(lk) || owns(rk)) || (soft(lk) && soft(rk))){
+                //we have not heard from it, or the pair is between two halo volumes and some other shard handles it, or the soft contact collider does
+                //a pair with only one side taken over stays here, a fast particle coming at a pile is stopped by its hit, not by how far a spring gets in a step
+                return;
+            }
+
+            const auto& rv = rkv->second;
+            //a held particle is not seen by the shard that owns its volume, so a pair with one is kept by the other side whatever the ids
+            const auto* l_held = std::get<6>(lv);
+            const auto* r_held = std::get<6>(rv);
+            auto check = [&](const particle<TIME, REAL, DIMS>& lp, const particle<TIME, REAL, DIMS>& rp_near){
+                if(!settings.species.interacts(lp.species, rp_near.species)){
+                    return;
+                }
+                const auto rp = periodic_image(settings.periodic, rp_near, wraps);
+                const TIME tt = blocking_collide_time(lp, rp, state.global_time);
+                if(tt != std::numeric_limits<TIME>::infinity() && tt >= state.global_time){
+                    //check the collision
+                    const bool l_first = lp.id < rp.id;
+                    if(owns(lk) && (l_first || (r_held && r_held->count(rp.id)))){
+                        //this could be the new hit for the left volume
+                        keep(lk, lp.id, rp.id, rk, tt);
+                    }else if(owns(rk) && (!l_first || (l_held && l_held->count(lp.id)))){
+                        //this could be the new hit for the right volume
+                        keep(rk, rp.id, lp.id, lk, tt);
+                    }
+                }
+            };
+
+            //two resting particles can never hit each other, so only pairs with at least one moving particle are checked
+            for_each_awake(lv, [&](const particle<TIME, REAL, DIMS>& lp){//for each moving particle in the first volume
+                for(const auto& rpkv : *std::get<0>(rv)){//against each particle in the second volume
+                    check(lp, rpkv.second);
+                }
+            });
+            const auto* r_awake = std::get<5>(rv);
+            if(std::get<5>(lv) && (!r_awake || r_awake->size())){
+                for(const auto& lpkv : *std::get<0>(lv)){//for each resting particle in the first volume
+                    if(is_resting(lpkv.second)){
+                        for_each_awake(rv, [&](const particle<TIME, REAL, DIMS>& rp){//against each moving particle in the second volume
+                            check(lpkv.second, rp);
+                        });
+                    }
+                }
+            }
+        });
+    }
 
     typename cadmium::make_message_bags<output_ports>::type output() const {
         typename cadmium::make_message_bags<output_ports>::type bag;
 
-        for(auto delta_msg : state.pending_deltas){
-            cadmium::get_messages<typename blocking_defs<TIME, REAL, DIMS>::particle_delta>(bag).push_back(delta_msg);
-        }
+        auto& deltas = cadmium::get_messages<typename blocking_defs<TIME, REAL, DIMS>::particle_delta>(bag);
+        deltas.insert(deltas.end(), state.pending_deltas.begin(), state.pending_deltas.end());
 
         return bag;
 
@@ -77,41 +287,75 @@ struct blocking_collider_model{
 
         //We just got here from the output function, we can clear the queued deltas.
         state.pending_deltas.clear();
-        state.next_internal_time = std::numeric_limits<TIME>::infinity();
 
-        for(auto& kv : state.volumes){
-            const std::array<long, DIMS> k = kv.first;
-            auto& v = kv.second;
-
-            if(std::get<4>(v) <= state.global_time){
-                const auto& v_id_l = k;
-                const auto& v_id_r = std::get<3>(v);
-
-                auto deltas = blocking_collide(std::get<0>(v)->at(std::get<1>(v)), std::get<0>(state.volumes.at(v_id_r))->at(std::get<2>(v)), state.global_time);
+        //fire every hit that is due, straight off the front of the queue
+        while(state.hit_queue.size() && state.hit_queue.begin()->first <= state.global_time){
+            const std::array<long, DIMS> k = state.hit_queue.begin()->second;
+            auto& v = state.volumes.at(k);
+
+            const auto& v_id_l = k;
+            const auto& v_id_r = std::get<3>(v);
+
+            //a volume can move a particle out in the same step that the particle is due to hit, before we hear about it
+            //the announcement about the move is on its way, and will have us look at both volumes again, so drop the hit
+            //the same goes for a volume that has emptied out and been dropped
+            const auto rv_it = state.volumes.find(v_id_r);
+            const auto lp_it = std::get<0>(v)->find(std::get<1>(v));
+            if(rv_it == state.volumes.end() || lp_it == std::get<0>(v)->end() || std::get<0>(rv_it->second)->find(std::get<2>(v)) == std::get<0>(rv_it->second)->end()){
+                set_hit_time(k, std::get<4>(v), std::numeric_limits<TIME>::infinity());
+                continue;
+            }
+            const auto& lp = lp_it->second;
+            //they are touching by now, so the nearest copy is the one that hits
+            const auto rp = minimum_image(settings.periodic, lp, std::get<0>(rv_it->second)->at(std::get<2>(v)), std::get<4>(v));
+
+            //a collision that was held back to share this transition is still worked out at the time it was predicted for
+            const TIME hit_time = std::get<4>(v);
+            const auto& rule = settings.species.at(lp.species, rp.species);
+            auto deltas = blocking_collide(lp, rp, hit_time, rule.losses, rule.stick_time, rule.extra_push);
+
+            if(hit_time < state.global_time){
+                state.coalesced.record(lp.mass, lp.velocity, deltas[0].dv, state.global_time - hit_time);
+                state.coalesced.record(rp.mass, rp.velocity, deltas[1].dv, state.global_time - hit_time);
+            }
 
-                deltas[0].volume_id = v_id_l;
-                deltas[1].volume_id = v_id_r;
+            deltas[0].volume_id = v_id_l;
+            deltas[1].volume_id = v_id_r;
 
-                state.pending_deltas.push_back(deltas[0]);
-                state.pending_deltas.push_back(deltas[1]);
+            state.pending_deltas.push_back(deltas[0]);
+            state.pending_deltas.push_back(deltas[1]);
 
-                std::get<4>(v) = std::numeric_limits<TIME>::infinity();
-                //this is a good place to invalidate cache, but not implementing well that yet
-            }
+            set_hit_time(k, std::get<4>(v), std::numeric_limits<TIME>::infinity());
+            //this is a good place to invalidate cache, but not implementing well that yet
         }
 
+        update_next_internal_time();
     }
 
     void external_transition(TIME dt, typename cadmium::make_message_bags<input_ports>::type mbs) {
         state.global_time += dt;
-        std::vector<std::array<long, DIMS>> dirty_volumes{};
+        auto& dirty_volumes = state.dirty_volumes;
+        dirty_volumes.clear();
         for(const auto& msg : cadmium::get_messages<typename blocking_defs<TIME, REAL, DIMS>::particle_announcement>(mbs)){
             dirty_volumes.push_back(msg.volume_id);
 
             if(!state.volumes.count(msg.volume_id)){
-                state.volumes[msg.volume_id] = {msg.volume_update, (size_t)(-1), (size_t)(-1), {}, std::numeric_limits<TIME>::infinity()};
+                state.volumes[msg.volume_id] = {msg.volume_update, (size_t)(-1), (size_t)(-1), {}, std::numeric_limits<TIME>::infinity(), msg.awake_particles, msg.held_particles};
             }else{
                 std::get<0>(state.volumes[msg.volume_id]) = msg.volume_update;
+                std::get<5>(state.volumes[msg.volume_id]) = msg.awake_particles;
+                std::get<6>(state.volumes[msg.volume_id]) = msg.held_particles;
+            }
+        }
+        for(const auto& msg : cadmium::get_messages<typename blocking_defs<TIME, REAL, DIMS>::contact_region>(mbs)){
+            if(msg.soft){
+                state.soft_volumes.insert(msg.volume_id);
+            }else{
+                state.soft_volumes.erase(msg.volume_id);
+            }
+            //taken over, its hits are dropped, given back, it is looked at again, and either way so is anything due to hit into it
+            if(state.volumes.count(msg.volume_id)){
+                dirty_volumes.push_back(msg.volume_id);
             }
         }
         if(dirty_volumes.size()){
@@ -119,56 +363,77 @@ struct blocking_collider_model{
             std::sort( dirty_volumes.begin(), dirty_volumes.end() );
             dirty_volumes.erase( std::unique( dirty_volumes.begin(), dirty_volumes.end() ), dirty_volumes.end() );
 
-            for(const auto& lk : dirty_volumes){ //for each volume that changed
-                auto& lv = state.volumes.at(lk);
-                std::get<4>(lv) = std::numeric_limits<TIME>::infinity(); //we *are* replacing this
-
-                for(auto& rkv : state.volumes){ //for each volume
-                    // TODO only iterate over the keys that are good, not all of the keys
-                    const auto& rk = rkv.first;
-                    bool good = true;
-                    for(size_t i = 0; i<DIMS; i++){
-                        good &= lk[i] == rk[i]+1 || lk[i] == rk[i] || lk[i] == rk[i]-1;
+            //a neighbour whose next hit is with a particle in a changed volume has to look again too, that particle may have moved or left
+            const size_t changed_count = dirty_volumes.size();
+            for(size_t i = 0; i<changed_count; i++){
+                const auto lk = dirty_volumes[i];
+                for_each_neighbour(lk, settings.periodic.grid, [&](const std::array<long, DIMS>& rk, const std::array<long, DIMS>&){
+                    auto rkv = state.volumes.find(rk);
+                    if(rkv != state.volumes.end() && std::get<4>(rkv->second) != std::numeric_limits<TIME>::infinity() && std::get<3>(rkv->second) == lk){
+                        dirty_volumes.push_back(rk);
                     }
-                    if(good){//if the second volume is near enough the first or is the first
-
-                        auto& rv = rkv.second;
-                        for(const auto& lpkv : *std::get<0>(lv)){//for each particle in the first volume
-                            const auto& lp = lpkv.second;
-                            for(const auto& rpkv : *std::get<0>(rv)){//for each particle in the second volume
-                                const auto& rp = rpkv.second;
-                                const TIME tt = blocking_collide_time(lp, rp, state.global_time);
-                                if(tt != std::numeric_limits<TIME>::infinity() && tt >= state.global_time){
-                                    //check the collision
-                                    if(lp.id < rp.id && tt < std::get<4>(lv)){
-                                        //this is the new hit for the left volume
-                                        std::get<1>(lv) = lp.id;
-                                        std::get<2>(lv) = rp.id;
-                                        std::get<3>(lv) = rk;
-                                        std::get<4>(lv) = tt;
-
-                                    }else if(tt < std::get<4>(rv)){
-                                        //this is the new hit for the right volume
-                                        std::get<1>(rv) = rp.id;
-                                        std::get<2>(rv) = lp.id;
-                                        std::get<3>(rv) = lk;
-                                        std::get<4>(rv) = tt;
-
-                                    }
-                                }
-                            }
-                        }
+                });
+            }
+            std::sort( dirty_volumes.begin(), dirty_volumes.end() );
+            dirty_volumes.erase( std::unique( dirty_volumes.begin(), dirty_volumes.end() ), dirty_volumes.end() );
+
+            for(const auto& lk : dirty_volumes){ //for each volume that changed
+                set_hit_time(lk, std::get<4>(state.volumes.at(lk)), std::numeric_limits<TIME>::infinity()); //we *are* replacing this
+            }
+
+            //the scans only read, so they can run side by side, each into its own list
+            //the lists are then applied in the order of dirty_volumes, which stores the same hits a single scan in that order would
+            auto& candidates = state.candidates;
+            if(candidates.size() < dirty_volumes.size()){
+                candidates.resize(dirty_volumes.size());
+            }
+            //they are scanned in morton order though, so each scan finds most of its neighbours still in cache from the one before
+            auto& scan_order = state.scan_order;
+            scan_order.resize(dirty_volumes.size());
+            for(size_t i = 0; i<scan_order.size(); i++){
+                scan_order[i] = i;
+            }
+            std::sort(scan_order.begin(), scan_order.end(), [&](std::size_t lhs, std::size_t rhs){
+                return morton_less<DIMS>{}(dirty_volumes[lhs], dirty_volumes[rhs]);
+            });
+            if(settings.threads > 1 && !state.pool){
+                state.pool = std::make_shared<thread_pool>(settings.threads);
+            }
+            auto scan_one = [&](std::size_t k){
+                const std::size_t i = scan_order[k];
+                scan(dirty_volumes[i], candidates[i]);
+            };
+            if(state.pool){
+                state.pool->parallel_for(dirty_volumes.size(), scan_one);
+            }else{
+                for(size_t i = 0; i<dirty_volumes.size(); i++){
+                    scan_one(i);
+                }
+            }
+
+            for(size_t i = 0; i<dirty_volumes.size(); i++){
+                for(const auto& hit : candidates[i]){
+                    auto& v = state.volumes.at(hit.volume_id);
+                    if(hit.time < std::get<4>(v)){
+                        std::get<1>(v) = hit.lhs;
+                        std::get<2>(v) = hit.rhs;
+                        std::get<3>(v) = hit.rhs_volume_id;
+                        set_hit_time(hit.volume_id, std::get<4>(v), hit.time);
                     }
                 }
             }
-        }
 
-        for(const auto& kv : state.volumes){ //update the next internal time
-            TIME tt = std::get<4>(kv.second);
-            if(tt < state.next_internal_time){
-                state.next_internal_time = tt;
+            //a volume that has emptied out has nothing left to hit or be hit, forget it until it announces something again
+            //anything that was going to hit into it is among the dirty volumes, and has just looked again
+            for(const auto& lk : dirty_volumes){
+                auto lkv = state.volumes.find(lk);
+                if(lkv != state.volumes.end() && std::get<0>(lkv->second)->empty() && std::get<4>(lkv->second) == std::numeric_limits<TIME>::infinity()){
+                    state.volumes.erase(lkv);
+                }
             }
         }
+
+        update_next_internal_time();
     }
 
     void confluence_transition(TIME, typename cadmium::make_message_bags<input_ports>::type mbs) {
@@ -0,0 +1,72 @@
+#ifndef __COALESCING_ERROR_HPP__
+#define __COALESCING_ERROR_HPP__
+
+#include <cstddef>
+#include <array>
+#include <vector>
+#include <cmath>
+#include <algorithm>
+#include <ostream>
+
+namespace tps{
+
+/*
+    When a model is given a coalescing tolerance, it waits from its first due event until the last event that is due within the tolerance of it,
+    and handles all of them in that one transition. Events are only ever late, never early, so the stick_time of a collision is never cut short.
+
+    Each late velocity change is worked out for the time it was due, and is applied whole.
+    Velocity changes add, so once it has landed every velocity is what it would have been, and so are the total momentum and energy.
+    Where it lands decides what else is lost.
+    A volume's own deferred dv goes in through apply_dv, which puts it in at the time it was due, so the particle's path stays exact,
+    only the models that hear about it hear about it late, see record_announced_late.
+    A collider's delta is put in by the volume when it gets there, so the particle keeps its old velocity for shift too long,
+    and from then on it is dv*shift away from where it should be, see record.
+    position sums |dv|*shift over those, so no particle can have drifted further than that from its exact path.
+    That drift is the only error coalescing itself makes, anything else, like a later hit that comes out different, follows from it.
+
+    late_momentum and late_energy are how much momentum, and kinetic energy, was held back by up to max_shift on its way to where it ended up.
+    They are not errors, but they bound how far off the totals can look to anything that adds them up in the meantime.
+*/
+template<typename TIME, typename REAL>
+struct coalescing_error{
+    std::size_t coalesced_events{0};
+    TIME max_shift{0};
+    REAL late_momentum{0};
+    REAL late_energy{0};
+    REAL position{0};
+
+    //a change that is put in late, the particle drifts off its path by up to |dv|*shift
+    template<std::size_t DIMS>
+    void record(REAL mass, const std::array<REAL, DIMS>& velocity, const std::array<REAL, DIMS>& dv, TIME shift){
+        position += record_announced_late(mass, velocity, dv, shift)*shift;
+    }
+
+    //a change that is put in at the time it was due, and only heard about late, returns |dv|
+    template<std::size_t DIMS>
+    REAL record_announced_late(REAL mass, const std::array<REAL, DIMS>& velocity, const std::array<REAL, DIMS>& dv, TIME shift){
+        coalesced_events++;
+        max_shift = std::max(max_shift, shift);
+
+        REAL dv_s = 0;
+        REAL v_s = 0;
+        REAL new_v_s = 0;
+        for(size_t i = 0; i<DIMS; i++){
+            dv_s += dv[i]*dv[i];
+            v_s += velocity[i]*velocity[i];
+            new_v_s += (velocity[i]+dv[i])*(velocity[i]+dv[i]);
+        }
+        dv_s = std::sqrt(dv_s);
+
+        late_momentum += mass*dv_s;
+        late_energy += std::abs(mass*(new_v_s-v_s)/2);
+        return dv_s;
+    }
+};
+
+template<typename TIME, typename REAL>
+std::ostream& operator<<(std::ostream& os, const coalescing_error<TIME, REAL>& err){
+    return os << "{\"events\":" << err.coalesced_events << ", \"max_shift\":" << err.max_shift << ", \"late_momentum\":" << err.late_momentum << ", \"late_energy\":" << err.late_energy << ", \"position\":" << err.position << "}";
+}
+
+}
+#endif /* __COALESCING_ERROR_HPP__ */
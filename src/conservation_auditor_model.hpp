@@ -0,0 +1,329 @@
+#ifndef __CONSERVATION_AUDITOR_MODEL_HPP__
+#define __CONSERVATION_AUDITOR_MODEL_HPP__
+
+
+#include <cadmium/modeling/ports.hpp>
+#include <cadmium/modeling/message_bag.hpp>
+
+#include <set>
+#include <array>
+#include <vector>
+#include <string>
+#include <limits>
+#include <cmath>
+#include <map>
+#include <stdexcept>
+#include <algorithm>
+
+#include "./particle.hpp"
+#include "./particle_moving_message.hpp"
+#include "./particle_announcement_message.hpp"
+#include "./conservation_drift_message.hpp"
+
+namespace tps{
+
+template<typename TIME, typename REAL, std::size_t DIMS>
+struct auditor_defs{
+
+    struct particle_announcement    : public cadmium::in_port<particle_announcement_message<TIME, REAL, DIMS>> {};
+    struct inflow                   : public cadmium::in_port<particle_moving_message<TIME, REAL, DIMS>> {};
+    struct outflow                  : public cadmium::in_port<particle_moving_message<TIME, REAL, DIMS>> {};
+
+    struct drift                    : public cadmium::out_port<conservation_drift_message<TIME, REAL, DIMS>> {};
+
+};
+
+/*
+    Keeps running totals of the particle count, momentum and kinetic energy of every volume it hears, and checks them each step of simulated time.
+    A deferred dv counts as already landed, so a collision that is half applied still adds up.
+    Each particle's share of the totals is kept, and an announcement only swaps the old share for the new one for the particles it lists
+    as changed or removed, so a collision costs one subtract and one add for each of its particles, however big the volume is.
+
+    The totals should only change by what comes in through inflow, from sources, and goes out through outflow, to sinks.
+    They are allowed to be off within a step, a collision is applied by two volumes and a move is announced by both ends one after the other,
+    so a step is checked once the step is over, when the next one starts, which costs the engine no steps of its own.
+    Nothing comes after the last step of the run to start another one, so with until set the auditor wakes up once, just before it, to check that one too.
+    A drift past tolerance sends out what changed, the volumes announced in the step and how much each particle's share changed,
+    and the totals it expects start over from where they are, so each bad step is only told about once.
+
+    Long range forces do not keep kinetic energy, and Barnes-Hut only keeps momentum to within theta, turn those checks off or loosen them there.
+    A split run only sees its own rank, particles crossing to another one look like they are lost.
+*/
+template<typename TIME, typename REAL, std::size_t DIMS>
+struct conservation_auditor_model{
+    struct settings_type{
+        //relative to the sum of m|v| for momentum, and to the total for energy
+        REAL tolerance{1e-6};
+        bool check_momentum{true};
+        bool check_energy{true};
+        //throw instead of only sending the drift out
+        bool fatal{false};
+        //the volume ids, outside of the grid, that particles on outflow are counted as gone from, empty takes everything it hears
+        std::set<std::array<long, DIMS>> outlets{};
+        //the time the run goes until, the last step before it is checked just before it, infinity leaves that step unchecked
+        TIME until{std::numeric_limits<TIME>::infinity()};
+    };
+    settings_type settings;
+
+    struct totals_type{
+        long count{0};
+        std::array<REAL, DIMS> momentum{};
+        REAL energy{0};
+        //sum of m|v|, what momentum drift is measured against
+        REAL scale{0};
+
+        void add(const totals_type& share, REAL sign){
+            count += (long)sign*share.count;
+            for(size_t i = 0; i<DIMS; i++){
+                momentum[i] += sign*share.momentum[i];
+            }
+            energy += sign*share.energy;
+            scale += sign*share.scale;
+        }
+    };
+
+    //what one particle adds to the totals
+    static totals_type share_of(const particle<TIME, REAL, DIMS>& par){
+        totals_type share{};
+        share.count = 1;
+        REAL v2 = 0;
+        for(size_t i = 0; i<DIMS; i++){
+            const REAL v = par.velocity[i]+(par.deferred_dv_time != std::numeric_limits<TIME>::infinity() ? par.deferred_dv[i] : REAL{0});
+            share.momentum[i] = par.mass*v;
+            v2 += v*v;
+        }
+        share.energy = par.mass*v2/2;
+        share.scale = par.mass*std::sqrt(v2);
+        return share;
+    }
+
+    struct state_type{
+        TIME global_time{0};
+        std::vector<conservation_drift_message<TIME, REAL, DIMS>> pending_drifts{};
+
+        totals_type totals{};
+        totals_type expected{};
+        bool started{false};
+
+        //which volume each particle was last announced by, and what it added to the totals then
+        std::map<std::size_t, std::pair<std::array<long, DIMS>, totals_type>> shares{};
+        //what was announced since the last check, and how much each particle's share changed that inflow and outflow do not explain
+        std::vector<std::array<long, DIMS>> announced{};
+        std::map<std::size_t, particle_drift<REAL, DIMS>> changed{};
+        //the step that is over once the time has moved past it, or infinity if nothing has happened since the last check
+        TIME step{std::numeric_limits<TIME>::infinity()};
+
+        std::size_t checks{0};
+        std::size_t drifts{0};
+
+        friend std::ostream& operator<<(std::ostream& os, const state_type& state) {
+            os << "{\"checks\":" << state.checks << ", \"drifts\":" << state.drifts << ", \"count\":" << state.totals.count << ", \"momentum\":[";
+            for(size_t i = 0; i<DIMS; i++){
+                if(i){
+                    os << ", ";
+                }
+                os << state.totals.momentum[i];
+            }
+            return os << "], \"energy\":" << state.totals.energy << "}";
+        }
+    };
+    state_type state;
+
+    using input_ports = std::tuple<
+        typename auditor_defs<TIME, REAL, DIMS>::particle_announcement,
+        typename auditor_defs<TIME, REAL, DIMS>::inflow,
+        typename auditor_defs<TIME, REAL, DIMS>::outflow
+    >;
+
+    using output_ports = std::tuple<
+        typename auditor_defs<TIME, REAL, DIMS>::drift
+    >;
+
+    conservation_auditor_model<TIME, REAL, DIMS>(){};
+    conservation_auditor_model<TIME, REAL, DIMS>(settings_type settings) : settings(std::move(settings)) {};
+
+    typename cadmium::make_message_bags<output_ports>::type output() const {
+        typename cadmium::make_message_bags<output_ports>::type bag;
+
+        auto& drifts = cadmium::get_messages<typename auditor_defs<TIME, REAL, DIMS>::drift>(bag);
+        drifts.insert(drifts.end(), state.pending_drifts.begin(), state.pending_drifts.end());
+
+        return bag;
+    }
+
+    //adds sign times share to what particle id has changed by in this step
+    void note_change(std::size_t id, const std::array<long, DIMS>& volume_id, const totals_type& share, REAL sign){
+        auto it = state.changed.find(id);
+        if(it == state.changed.end()){
+            it = state.changed.emplace(id, particle_drift<REAL, DIMS>{id, volume_id, 0, {}, 0}).first;
+        }
+        auto& change = it->second;
+        change.volume_id = volume_id;
+        change.count += (long)sign*share.count;
+        for(size_t i = 0; i<DIMS; i++){
+            change.momentum[i] += sign*share.momentum[i];
+        }
+        change.energy += sign*share.energy;
+    }
+
+    //compares the totals with what they should be at the end of the step at time
+    void check(TIME time){
+        state.checks++;
+        if(!state.started){
+            //everything announced before the first step is over is where the run starts from
+            state.started = true;
+            state.expected = state.totals;
+            state.announced.clear();
+            state.changed.clear();
+            return;
+        }
+
+        conservation_drift_message<TIME, REAL, DIMS> drift{};
+        drift.time = time;
+        drift.count = state.totals.count-state.expected.count;
+        REAL p2 = 0;
+        for(size_t i = 0; i<DIMS; i++){
+            drift.momentum[i] = state.totals.momentum[i]-state.expected.momentum[i];
+            p2 += drift.momentum[i]*drift.momentum[i];
+        }
+        drift.energy = state.totals.energy-state.expected.energy;
+
+        const bool bad = drift.count != 0
+            || (settings.check_momentum && std::sqrt(p2) > settings.tolerance*state.expected.scale)
+            || (settings.check_energy && std::abs(drift.energy) > settings.tolerance*state.expected.energy);
+
+        if(bad){
+            std::sort(state.announced.begin(), state.announced.end());
+            state.announced.erase(std::unique(state.announced.begin(), state.announced.end()), state.announced.end());
+            drift.volumes.swap(state.announced);
+            for(const auto& ckv : state.changed){
+                const auto& change = ckv.second;
+                bool moved = change.count != 0 || change.energy != REAL{0};
+                for(size_t i = 0; i<DIMS; i++){
+                    moved |= change.momentum[i] != REAL{0};
+                }
+                if(moved){
+                    drift.particles.push_back(change);
+                }
+            }
+            state.drifts++;
+            state.expected = state.totals;
+            if(settings.fatal){
+                std::string particles{};
+                for(const auto& par : drift.particles){
+                    particles += " " + std::to_string(par.id) + " (count " + std::to_string(par.count) + ", energy " + std::to_string((double)par.energy) + ")";
+                }
+                throw std::runtime_error("conservation drift at time " + std::to_string((double)time) + ": count " + std::to_string(drift.count) + ", energy " + std::to_string((double)drift.energy) + ", particles" + particles);
+            }
+            state.pending_drifts.push_back(std::move(drift));
+        }else{
+            //collisions do not keep the sum of m|v|, it is only a yardstick, so it just follows the totals
+            state.expected.scale = state.totals.scale;
+        }
+        state.announced.clear();
+        state.changed.clear();
+    }
+
+    void internal_transition(){
+        state.global_time += time_advance();
+
+        //We just got here from the output function, we can clear what it sent
+        if(state.pending_drifts.size()){
+            state.pending_drifts.clear();
+            return;
+        }
+
+        //the run is about to end, nothing can happen in the last step any more
+        if(state.step < state.global_time){
+            check(state.step);
+            state.step = std::numeric_limits<TIME>::infinity();
+        }
+    }
+
+    void external_transition(TIME dt, typename cadmium::make_message_bags<input_ports>::type mbs) {
+        //the last step is over once we hear about a later one
+        if(dt > TIME{0} && state.step < state.global_time+dt){
+            check(state.step);
+        }
+        state.global_time += dt;
+        state.step = state.global_time;
+
+        const std::array<long, DIMS> outside{};
+        for(const auto& move_msg : cadmium::get_messages<typename auditor_defs<TIME, REAL, DIMS>::inflow>(mbs)){
+            for(const auto& par : move_msg){
+                const auto share = share_of(par);
+                state.expected.add(share, 1);
+                note_change(par.id, outside, share, -1);
+            }
+        }
+        for(const auto& move_msg : cadmium::get_messages<typename auditor_defs<TIME, REAL, DIMS>::outflow>(mbs)){
+            if(settings.outlets.size() && !settings.outlets.count(move_msg.destination_id)){
+                continue;
+            }
+            for(const auto& par : move_msg){
+                const auto share = share_of(par);
+                state.expected.add(share, -1);
+                note_change(par.id, move_msg.destination_id, share, 1);
+            }
+        }
+
+        for(const auto& msg : cadmium::get_messages<typename auditor_defs<TIME, REAL, DIMS>::particle_announcement>(mbs)){
+            //a particle that has moved on is taken out here, unless the volume it went to has already taken it
+            for(const auto id : *msg.particle_removed){
+                auto it = state.shares.find(id);
+                if(it != state.shares.end() && it->second.first == msg.volume_id){
+                    state.totals.add(it->second.second, -1);
+                    note_change(id, msg.volume_id, it->second.second, -1);
+                    state.shares.erase(it);
+                }
+            }
+            //a changed particle comes out of wherever it was counted before, and goes in again as it is now
+            for(const auto id : *msg.particle_changed){
+                auto par_it = msg.volume_update->find(id);
+                if(par_it == msg.volume_update->end()){
+                    continue;
+                }
+                auto it = state.shares.find(id);
+                if(it != state.shares.end()){
+                    state.totals.add(it->second.second, -1);
+                    note_change(id, msg.volume_id, it->second.second, -1);
+                }
+                const auto share = share_of(par_it->second);
+                state.totals.add(share, 1);
+                note_change(id, msg.volume_id, share, 1);
+                state.shares[id] = {msg.volume_id, share};
+            }
+            state.announced.push_back(msg.volume_id);
+        }
+    }
+
+    void confluence_transition(TIME, typename cadmium::make_message_bags<input_ports>::type mbs) {
+        internal_transition();
+        external_transition(TIME{}, std::move(mbs));
+    }
+
+
+    TIME time_advance() const {
+        if(state.pending_drifts.size()){
+            return {0};
+        }else if(state.step != std::numeric_limits<TIME>::infinity() && settings.until != std::numeric_limits<TIME>::infinity()){
+            //the last time before the end of the run, every step but the last is checked by the next one before this comes up
+            const TIME last = std::nextafter(settings.until, -std::numeric_limits<TIME>::infinity());
+            return std::max(last, std::nextafter(state.step, std::numeric_limits<TIME>::infinity()))-state.global_time;
+        }else{
+            return std::numeric_limits<TIME>::infinity();
+        }
+    }
+
+
+    friend std::ostream& operator<<(std::ostream& os, const conservation_auditor_model& auditor) {
+        return os << auditor.state;
+    }
+
+
+};
+
+
+
+}
+#endif /* __CONSERVATION_AUDITOR_MODEL_HPP__ */
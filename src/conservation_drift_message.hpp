@@ -0,0 +1,99 @@
+#ifndef __CONSERVATION_DRIFT_MESSAGE_HPP__
+#define __CONSERVATION_DRIFT_MESSAGE_HPP__
+
+#include <array>
+#include <vector>
+#include <ostream>
+
+#include "./log_filter.hpp"
+
+namespace tps{
+
+/*
+    How much one particle's share of the totals changed over the step, past what coming in through a source or going out through a sink explains.
+    A particle that got lost on a move shows up with count -1, one that was announced twice with +1.
+    The two particles of a collision each show what it gave them, and those should cancel out, a pair that does not is the collision that drifted.
+*/
+template<typename REAL, std::size_t DIMS>
+struct particle_drift{
+    std::size_t id;
+    std::array<long, DIMS> volume_id;           //the volume that last announced it
+    long count;
+    std::array<REAL, DIMS> momentum;
+    REAL energy;
+};
+
+/*
+    How far the particles' totals moved from what they should have been over one step of simulated time, and which volumes and particles changed in that step.
+    Each drift is what the totals are now minus what they should be.
+*/
+template<typename TIME, typename REAL, std::size_t DIMS>
+struct conservation_drift_message{
+    TIME time;                                  //the step the drift showed up in
+    long count;
+    std::array<REAL, DIMS> momentum;
+    REAL energy;                                //kinetic, with every deferred dv counted as already landed
+    std::vector<std::array<long, DIMS>> volumes{};   //every volume that announced something in the step
+    std::vector<particle_drift<REAL, DIMS>> particles{};    //every particle whose share changed in the step, in id order
+};
+
+template<typename TIME, typename REAL, std::size_t DIMS>
+std::ostream& operator<<(std::ostream& os, const conservation_drift_message<TIME, REAL, DIMS>& msg) {
+    if(!current_log_view().open){
+        return os;
+    }
+
+    os << "[" << msg.time << ", " << msg.count << ", [";
+
+    for(size_t i = 0; i<DIMS; i++){
+        if(i){
+            os << ", ";
+        }
+        os << msg.momentum[i];
+    }
+
+    os << "], " << msg.energy << ", [";
+
+    for(size_t v = 0; v<msg.volumes.size(); v++){
+        if(v){
+            os << ", ";
+        }
+        os << "[";
+        for(size_t i = 0; i<DIMS; i++){
+            if(i){
+                os << ", ";
+            }
+            os << msg.volumes[v][i];
+        }
+        os << "]";
+    }
+
+    os << "], [";
+
+    for(size_t p = 0; p<msg.particles.size(); p++){
+        const auto& par = msg.particles[p];
+        if(p){
+            os << ", ";
+        }
+        os << "[" << par.id << ", [";
+        for(size_t i = 0; i<DIMS; i++){
+            if(i){
+                os << ", ";
+            }
+            os << par.volume_id[i];
+        }
+        os << "], " << par.count << ", [";
+        for(size_t i = 0; i<DIMS; i++){
+            if(i){
+                os << ", ";
+            }
+            os << par.momentum[i];
+        }
+        os << "], " << par.energy << "]";
+    }
+
+    return os << "]]";
+}
+
+}
+#endif /* __CONSERVATION_DRIFT_MESSAGE_HPP__ */
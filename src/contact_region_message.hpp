@@ -0,0 +1,39 @@
+#ifndef __CONTACT_REGION_MESSAGE_HPP__
+#define __CONTACT_REGION_MESSAGE_HPP__
+
+#include <array>
+#include <ostream>
+
+#include "./log_filter.hpp"
+
+namespace tps{
+
+//the soft contact collider taking a volume over from the blocking colliders, or giving it back to them with soft = false
+template<std::size_t DIMS>
+struct contact_region_message{
+    std::array<long, DIMS> volume_id;
+    bool soft;
+};
+
+template<std::size_t DIMS>
+std::ostream& operator<<(std::ostream& os, const contact_region_message<DIMS>& msg) {
+    const auto& view = current_log_view();
+    const auto& filter = view.rules();
+    if(!view.open || !filter.volume(msg.volume_id)){
+        return os;
+    }
+
+    os << "[[";
+
+    for(size_t i = 0; i<DIMS; i++){
+        if(i){
+            os << ", ";
+        }
+        os << msg.volume_id[i];
+    }
+
+    return os << "], " << (msg.soft ? "true" : "false") << "]";
+}
+
+}
+#endif /* __CONTACT_REGION_MESSAGE_HPP__ */
@@ -0,0 +1,33 @@
+#ifndef __DOUBLE_BUFFER_HPP__
+#define __DOUBLE_BUFFER_HPP__
+
+#include <cstddef>
+#include <array>
+
+namespace tps{
+
+/*
+    Two of something, one being filled in, and the other left as it was when it was last handed out.
+    A model's output points at the one being filled in, and its next internal transition flips to the other,
+    so what went out stays put until the flip after that, by when every receiver of it has had its transition.
+    Both keep what they have reserved, so after a short warm up filling one in never goes to the heap.
+*/
+template<typename T>
+struct double_buffer{
+    std::array<T, 2> sides{};
+    std::size_t front{0};
+
+    T& operator*(){ return sides[front]; }
+    const T& operator*() const { return sides[front]; }
+    T* operator->(){ return &sides[front]; }
+    const T* operator->() const { return &sides[front]; }
+
+    //the other side, emptied, is the one filled in from here on
+    void flip(){
+        front = 1-front;
+        sides[front].clear();
+    }
+};
+
+}
+#endif /* __DOUBLE_BUFFER_HPP__ */
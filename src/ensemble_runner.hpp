@@ -0,0 +1,301 @@
+#ifndef __ENSEMBLE_RUNNER_HPP__
+#define __ENSEMBLE_RUNNER_HPP__
+
+#include <cadmium/modeling/dynamic_model.hpp>
+#include <cadmium/modeling/dynamic_model_translator.hpp>
+#include <cadmium/engine/pdevs_dynamic_runner.hpp>
+#include <cadmium/logger/common_loggers.hpp>
+
+#include <nlohmann/json.hpp>
+
+#include <array>
+#include <vector>
+#include <map>
+#include <string>
+#include <memory>
+#include <limits>
+#include <cmath>
+#include <chrono>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <stdexcept>
+#include <exception>
+
+#include "./particle.hpp"
+#include "./grid_topology.hpp"
+#include "./scenario_loader.hpp"
+#include "./snapshot_model.hpp"
+#include "./thread_pool.hpp"
+
+namespace tps{
+
+/*
+    One run of an ensemble, as the changes it makes to the ensemble's base scenario.
+    Anything left unset is read straight from the base, which every case shares and nothing writes to.
+*/
+template<typename TIME, typename REAL, std::size_t DIMS>
+struct ensemble_case{
+    std::string name{};
+    //replaces the base's species table
+    std::shared_ptr<const species_table<TIME, REAL>> species{};
+    //replace the base's particles with the same id, or are added if it has none with that id
+    std::vector<particle<TIME, REAL, DIMS>> particles{};
+    //nan takes the base's end_time
+    TIME end_time{std::numeric_limits<TIME>::quiet_NaN()};
+};
+
+//what the whole run adds up to at one time, a deferred dv counts as already landed like the auditor has it
+template<typename TIME, typename REAL, std::size_t DIMS>
+struct ensemble_sample{
+    TIME time{0};
+    long count{0};
+    std::array<REAL, DIMS> momentum{};
+    REAL energy{0};
+};
+
+template<typename TIME, typename REAL, std::size_t DIMS>
+struct ensemble_result{
+    std::string name{};
+    //empty if the case ran to its end_time
+    std::string error{};
+    std::vector<ensemble_sample<TIME, REAL, DIMS>> samples{};
+    //every particle at the end, the volume pointers in it are cleared once the run is gone
+    particle_snapshot<TIME, REAL, DIMS> last{};
+    double wall_seconds{0};
+};
+
+/*
+    Many independent runs of the same scenario in one process, each on a thread of its own pool.
+    Each case builds its own grid and runner with no logging at all, so they share nothing that changes,
+    and results[k] is always case k's no matter which thread ran it, so a sweep comes out the same however many threads it had.
+    Builds with TPS_TRACE are not safe to run this way, the trace is one per process.
+*/
+template<typename TIME, typename REAL, std::size_t DIMS>
+struct ensemble{
+    using case_type = ensemble_case<TIME, REAL, DIMS>;
+    using result_type = ensemble_result<TIME, REAL, DIMS>;
+
+    std::shared_ptr<const scenario<TIME, REAL, DIMS>> base{};
+    std::vector<case_type> cases{};
+    //runs at once, counting the calling thread
+    std::size_t threads{1};
+    //time between samples, 0 only samples at 0 and end_time
+    TIME sample_interval{0};
+
+    static ensemble_sample<TIME, REAL, DIMS> measure(const particle_snapshot<TIME, REAL, DIMS>& snap, TIME t){
+        ensemble_sample<TIME, REAL, DIMS> sample{};
+        sample.time = t;
+        for(const auto& vkv : snap.volumes){
+            for(const auto& pkv : *vkv.second){
+                const auto& par = pkv.second;
+                sample.count++;
+                REAL v2 = 0;
+                for(size_t i = 0; i<DIMS; i++){
+                    const REAL v = par.velocity[i]+(par.deferred_dv_time != std::numeric_limits<TIME>::infinity() ? par.deferred_dv[i] : REAL{0});
+                    sample.momentum[i] += par.mass*v;
+                    v2 += v*v;
+                }
+                sample.energy += par.mass*v2/2;
+            }
+        }
+        return sample;
+    }
+
+    //the base's particles with the case's laid over them, in id order
+    std::vector<particle<TIME, REAL, DIMS>> particles_of(const case_type& c) const {
+        if(c.particles.empty()){
+            return base->particles;
+        }
+        std::map<std::size_t, particle<TIME, REAL, DIMS>> by_id{};
+        for(const auto& par : base->particles){
+            by_id[par.id] = par;
+        }
+        for(const auto& par : c.particles){
+            by_id[par.id] = par;
+        }
+        std::vector<particle<TIME, REAL, DIMS>> merged{};
+        for(const auto& kv : by_id){
+            merged.push_back(kv.second);
+        }
+        return merged;
+    }
+
+    void run_case(const case_type& c, result_type& result) const {
+        using namespace cadmium;
+        result.name = c.name;
+        const TIME end_time = std::isnan(c.end_time) ? base->end_time : c.end_time;
+        if(!(end_time < std::numeric_limits<TIME>::infinity())){
+            throw std::runtime_error("case " + c.name + " has no end_time");
+        }
+
+        auto snapshot = std::make_shared<particle_snapshot<TIME, REAL, DIMS>>();
+        {
+            auto settings = base->settings();
+            if(c.species){
+                settings.species = *c.species;
+            }
+            auto grid = make_sharded_grid<TIME, REAL, DIMS>(
+                base->grid_size, base->corner, base->volume_size, base->shard_size, particles_of(c), base->open_edges, settings
+            );
+            add_snapshot<TIME, REAL, DIMS>(grid, snapshot);
+
+            auto top = std::make_shared<dynamic::modeling::coupled<TIME>>(
+                "TOP", grid.models, dynamic::modeling::Ports{}, dynamic::modeling::Ports{}, dynamic::modeling::EICs{}, dynamic::modeling::EOCs{}, grid.ics
+            );
+            dynamic::engine::runner<TIME, logger::not_logger> runner(top, TIME{0});
+
+            //each sample includes what happens at its time, like atps_native does
+            TIME t = 0;
+            while(true){
+                runner.run_until(std::nextafter(t, std::numeric_limits<TIME>::infinity()));
+                result.samples.push_back(measure(*snapshot, t));
+                if(t >= end_time){
+                    break;
+                }
+                t = sample_interval > 0 ? std::min(t+sample_interval, end_time) : end_time;
+            }
+            snapshot->take(end_time);
+        }
+        //the maps it pointed at went with the runner
+        snapshot->volumes.clear();
+        result.last = std::move(*snapshot);
+    }
+
+    //runs every case, a case that throws has its error kept in its result and does not stop the others
+    std::vector<result_type> run() const {
+        std::vector<result_type> results(cases.size());
+        thread_pool pool(threads);
+        pool.parallel_for(cases.size(), [&](std::size_t k){
+            const auto began = std::chrono::steady_clock::now();
+            try{
+                run_case(cases[k], results[k]);
+            }catch(const std::exception& e){
+                results[k].name = cases[k].name;
+                results[k].error = e.what();
+            }
+            results[k].wall_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now()-began).count();
+        });
+        return results;
+    }
+};
+
+/*
+    An ensemble in json:
+        {"scenario": "base.json" or the scenario itself, "threads": 4, "sample_interval": 1,
+         "cases": [{"name": "...", "species_default": {...}, "species": [...], "particles": [...], "end_time": 20}, ...],
+         "sweep": {"losses": [0, 0.1], "stick_time": [...], "extra_push": [...]}}
+    A case's species_default and species are laid over the base's table, the way a scenario lays them over the defaults.
+    sweep adds a case for every combination of the values it lists, each changing species_default and nothing else,
+    so pairs the base sets on their own are not swept. A relative scenario path is taken from where the ensemble file is.
+*/
+template<typename TIME, typename REAL, std::size_t DIMS>
+ensemble<TIME, REAL, DIMS> load_ensemble(std::istream& is, const std::string& directory = "."){
+    const nlohmann::json j = nlohmann::json::parse(is);
+    ensemble<TIME, REAL, DIMS> ens{};
+
+    const auto& js = j.at("scenario");
+    if(js.is_string()){
+        const auto path = js.get<std::string>();
+        ens.base = std::make_shared<const scenario<TIME, REAL, DIMS>>(load_scenario<TIME, REAL, DIMS>(path.size() && path[0] == '/' ? path : directory + "/" + path));
+    }else{
+        std::istringstream text{js.dump()};
+        ens.base = std::make_shared<const scenario<TIME, REAL, DIMS>>(load_scenario<TIME, REAL, DIMS>(text));
+    }
+    ens.threads = j.value("threads", std::size_t{1});
+    ens.sample_interval = j.value("sample_interval", TIME{0});
+
+    for(const auto& jc : j.value("cases", nlohmann::json::array())){
+        ensemble_case<TIME, REAL, DIMS> c{};
+        c.name = jc.value("name", "case_" + std::to_string(ens.cases.size()));
+        if(jc.contains("species_default") || jc.contains("species")){
+            auto table = ens.base->species;
+            if(jc.contains("species_default")){
+                table.fallback = species_interaction_from_json(jc.at("species_default"), table.fallback);
+            }
+            for(const auto& jr : jc.value("species", nlohmann::json::array())){
+                const auto pair = jr.at("pair").get<std::array<std::size_t, 2>>();
+                table.set(pair[0], pair[1], species_interaction_from_json(jr, table.fallback));
+            }
+            c.species = std::make_shared<const species_table<TIME, REAL>>(std::move(table));
+        }
+        for(const auto& jp : jc.value("particles", nlohmann::json::array())){
+            c.particles.push_back(particle_from_json<TIME, REAL, DIMS>(jp));
+        }
+        if(jc.contains("end_time")){
+            c.end_time = jc.at("end_time").get<TIME>();
+        }
+        ens.cases.push_back(std::move(c));
+    }
+
+    if(j.contains("sweep")){
+        //every combination, the last field listed changes fastest
+        std::vector<nlohmann::json> combos{nlohmann::json::object()};
+        for(const auto& field : j.at("sweep").items()){
+            std::vector<nlohmann::json> grown{};
+            for(const auto& combo : combos){
+                for(const auto& value : field.value()){
+                    auto next = combo;
+                    next[field.key()] = value;
+                    grown.push_back(std::move(next));
+                }
+            }
+            combos.swap(grown);
+        }
+        for(const auto& combo : combos){
+            ensemble_case<TIME, REAL, DIMS> c{};
+            for(const auto& field : combo.items()){
+                c.name += (c.name.empty() ? "" : ",") + field.key() + "=" + field.value().dump();
+            }
+            auto table = ens.base->species;
+            table.fallback = species_interaction_from_json(combo, table.fallback);
+            c.species = std::make_shared<const species_table<TIME, REAL>>(std::move(table));
+            ens.cases.push_back(std::move(c));
+        }
+    }
+    return ens;
+}
+
+template<typename TIME, typename REAL, std::size_t DIMS>
+ensemble<TIME, REAL, DIMS> load_ensemble(const std::string& path){
+    std::ifstream is(path);
+    if(!is){
+        throw std::runtime_error("could not open ensemble " + path);
+    }
+    const auto slash = path.find_last_of('/');
+    return load_ensemble<TIME, REAL, DIMS>(is, slash == std::string::npos ? "." : path.substr(0, slash));
+}
+
+/*
+    Every result as one json array, each case is
+        {"name", "error", "wall_seconds", "samples": [[time, count, [momentum], energy], ...], "particles": [[id, species, mass, radius, [position], [velocity]], ...]}
+    with the particles as they were at the case's end_time.
+*/
+template<typename TIME, typename REAL, std::size_t DIMS>
+nlohmann::json ensemble_results_json(const std::vector<ensemble_result<TIME, REAL, DIMS>>& results, bool with_wall_time = true){
+    nlohmann::json out = nlohmann::json::array();
+    for(const auto& result : results){
+        nlohmann::json jr{{"name", result.name}, {"error", result.error}};
+        if(with_wall_time){
+            jr["wall_seconds"] = result.wall_seconds;
+        }
+        jr["samples"] = nlohmann::json::array();
+        for(const auto& s : result.samples){
+            jr["samples"].push_back({s.time, s.count, s.momentum, s.energy});
+        }
+        jr["particles"] = nlohmann::json::array();
+        const auto& last = result.last;
+        for(std::size_t k = 0; k<last.size(); k++){
+            jr["particles"].push_back({
+                last.id[k], last.species[k], last.mass[k], last.radius[k],
+                std::vector<REAL>(last.position.begin()+k*DIMS, last.position.begin()+(k+1)*DIMS),
+                std::vector<REAL>(last.velocity.begin()+k*DIMS, last.velocity.begin()+(k+1)*DIMS)
+            });
+        }
+        out.push_back(std::move(jr));
+    }
+    return out;
+}
+
+}
+#endif /* __ENSEMBLE_RUNNER_HPP__ */
@@ -0,0 +1,82 @@
+#ifndef __FILTERED_LOGGER_HPP__
+#define __FILTERED_LOGGER_HPP__
+
+#include <cadmium/logger/common_loggers.hpp>
+
+#include <string>
+#include <type_traits>
+
+#include "./log_filter.hpp"
+
+namespace tps{
+
+/*
+    Wraps any Cadmium logger, or multilogger, so it only sees the steps and models a log_filter lets through.
+    FILTER is handed in like a sink is, a struct with a static filter() that returns the log_filter, so two runners can each have their own.
+    Each step starts with its global time being logged, that is where the filter decides, and then everything up to the next one goes the same way.
+    Time windows need a TIME that converts to double, with any other TIME only every is used.
+
+    Every other record is about one model, and its first string is that model's id. Cadmium logs a model's id, with its info or local time,
+    before it formats what the model sent or its state, so this thread's log_view is set for the model first, and a model that is left out is never formatted.
+    Its records are dropped here, as are the records the other filters left with nothing in them, so the log has no empty entries for them.
+*/
+template<typename LOGGER, typename FILTER>
+struct filtered_logger{
+    //true if every message in a record was filtered out, which leaves each port as {}
+    static bool nothing_left(const std::string& record){
+        for(std::size_t i = record.find('{'); i != std::string::npos; i = record.find('{', i+1)){
+            if(i+1 == record.size() || record[i+1] != '}'){
+                return false;
+            }
+        }
+        return true;
+    }
+
+    template<typename... SOURCES, typename... PARAMs>
+    static void log(const PARAMs&... ps){
+        auto& filter = FILTER::filter();
+        auto& view = current_log_view();
+        view.filter = &filter;
+        if constexpr (sizeof...(PARAMs) == 1){
+            if((std::is_same<SOURCES, cadmium::logger::logger_global_time>::value || ...)){
+                if constexpr ((std::is_convertible<PARAMs, double>::value && ...)){
+                    filter.start_step(static_cast<double>(ps)...);
+                    view.open = filter.step_open;
+                }
+            }
+        }
+
+        //the first string is the model's id, and for states and messages the last one is what got formatted
+        const std::string* model_id = nullptr;
+        const std::string* record = nullptr;
+        auto look = [&](const auto& p){
+            if constexpr (std::is_same<std::decay_t<decltype(p)>, std::string>::value){
+                if(model_id){
+                    record = &p;
+                }else{
+                    model_id = &p;
+                }
+            }
+        };
+        (look(ps), ...);
+        if(model_id){
+            view.open = filter.lets_model(*model_id);
+        }
+        if(!view.open){
+            return;
+        }
+
+        if(record && filter.narrows()){
+            if((std::is_same<SOURCES, cadmium::logger::logger_state>::value || ...) && record->empty()){
+                return;
+            }
+            if((std::is_same<SOURCES, cadmium::logger::logger_messages>::value || ...) && nothing_left(*record)){
+                return;
+            }
+        }
+        LOGGER::template log<SOURCES...>(ps...);
+    }
+};
+
+}
+#endif /* __FILTERED_LOGGER_HPP__ */
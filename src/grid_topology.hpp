@@ -0,0 +1,584 @@
+#ifndef __GRID_TOPOLOGY_HPP__
+#define __GRID_TOPOLOGY_HPP__
+
+#include <cadmium/modeling/dynamic_model.hpp>
+#include <cadmium/modeling/dynamic_model_translator.hpp>
+
+#include <array>
+#include <vector>
+#include <map>
+#include <set>
+#include <string>
+#include <limits>
+#include <cmath>
+#include <algorithm>
+#include <memory>
+#include <stdexcept>
+
+#include "./particle.hpp"
+#include "./volume_model.hpp"
+#include "./blocking_collider_model.hpp"
+#include "./volume_neighbours.hpp"
+#include "./periodic_boundary.hpp"
+#include "./rank_bridge_model.hpp"
+#include "./long_range_model.hpp"
+#include "./particle_source_model.hpp"
+#include "./particle_sink_model.hpp"
+#include "./observer_model.hpp"
+#include "./conservation_auditor_model.hpp"
+#include "./snapshot_model.hpp"
+#include "./soft_contact_model.hpp"
+#include "./sparse_grid_model.hpp"
+#include "./transition_trace.hpp"
+#include "./transport.hpp"
+
+namespace tps{
+
+template<std::size_t DIMS>
+std::string volume_name(const std::array<long, DIMS>& volume_id, const std::string& prefix = "vol"){
+    std::string name = prefix;
+    for(size_t i = 0; i<DIMS; i++){
+        name += "_" + std::to_string(volume_id[i]);
+    }
+    return name;
+}
+
+/*
+    The models and couplings of a regular grid of volumes, split into boxes of volumes that each get their own blocking collider.
+    Each collider shard owns the volumes in its box, and listens to the ring of volumes around its box as a halo.
+    Drop these into a dynamic::modeling::coupled next to anything else the run needs.
+    Built with TPS_TRACE defined, the volumes and colliders record every call into them in active_trace, see transition_trace.hpp.
+*/
+template<typename TIME, typename REAL, std::size_t DIMS>
+struct grid_topology{
+#ifdef TPS_TRACE
+    template<typename TT>
+    using volume = traced_model<volume_model<TT, REAL, DIMS>>;
+    template<typename TT>
+    using collider = traced_model<blocking_collider_model<TT, REAL, DIMS>>;
+    template<typename TT>
+    using sparse_grid = traced_model<sparse_grid_model<TT, REAL, DIMS>>;
+#else
+    template<typename TT>
+    using volume = volume_model<TT, REAL, DIMS>;
+    template<typename TT>
+    using collider = blocking_collider_model<TT, REAL, DIMS>;
+    template<typename TT>
+    using sparse_grid = sparse_grid_model<TT, REAL, DIMS>;
+#endif
+    template<typename TT>
+    using bridge = rank_bridge_model<TT, REAL, DIMS>;
+    template<typename TT>
+    using long_range = long_range_model<TT, REAL, DIMS>;
+    template<typename TT>
+    using source = particle_source_model<TT, REAL, DIMS>;
+    template<typename TT>
+    using sink = particle_sink_model<TT, REAL, DIMS>;
+    template<typename TT>
+    using observer = observer_model<TT, REAL, DIMS>;
+    template<typename TT>
+    using auditor = conservation_auditor_model<TT, REAL, DIMS>;
+    template<typename TT>
+    using snapshot = snapshot_model<TT, REAL, DIMS>;
+    template<typename TT>
+    using soft_contact = soft_contact_model<TT, REAL, DIMS>;
+
+    std::array<long, DIMS> grid_size{};
+    std::array<REAL, DIMS> volume_size{};
+
+    cadmium::dynamic::modeling::Models models{};
+    cadmium::dynamic::modeling::ICs ics{};
+
+    std::map<std::array<long, DIMS>, std::string> volume_names{};
+    std::map<std::array<long, DIMS>, std::string> shard_names{};
+
+    //set instead of volume_names when every volume lives inside one sparse_grid_model
+    std::string sparse_name{};
+    //set when that model may spill resting volumes out of memory, anything that reads the particle maps can not be added then
+    bool spills{false};
+
+    //how each pair of species meets, as every collider shard was told
+    species_table<TIME, REAL> species{};
+
+    //the models that volume ports belong to
+    std::vector<std::string> volume_models() const {
+        if(sparse_name.size()){
+            return {sparse_name};
+        }
+        std::vector<std::string> names{};
+        for(const auto& vkv : volume_names){
+            names.push_back(vkv.second);
+        }
+        return names;
+    }
+
+    //the models particles leave the grid from, and if outlets is empty, every volume id off the edge of the grid goes into it
+    std::vector<std::string> edge_volumes(std::set<std::array<long, DIMS>>& outlets) const {
+        const bool take_all = outlets.empty();
+        std::vector<std::string> names{};
+        if(sparse_name.size()){
+            //a sparse grid only sends out what leaves its bounds, so there is nothing to pick out
+            names.push_back(sparse_name);
+        }
+        for(const auto& vkv : volume_names){
+            bool edge = false;
+            for(size_t i = 0; i<DIMS; i++){
+                for(long step : {-1L, 1L}){
+                    auto nid = vkv.first;
+                    nid[i] += step;
+                    if(nid[i] < 0 || nid[i] >= grid_size[i]){
+                        edge = true;
+                        if(take_all){
+                            outlets.insert(nid);
+                        }
+                    }
+                }
+            }
+            if(edge){
+                names.push_back(vkv.second);
+            }
+        }
+        return names;
+    }
+};
+
+/*
+    Splits a grid between processes in slabs along axis 0, rank r gets the volumes with id[0] in [r*grid_size[0]/ranks, (r+1)*grid_size[0]/ranks).
+    If cuts is given it holds the ranks-1 slab edges instead, rank r gets id[0] in [cuts[r-1], cuts[r]).
+    lower and upper link to ranks r-1 and r+1, and are left empty at the ends.
+*/
+template<typename TIME>
+struct rank_partition{
+    std::size_t rank{0};
+    std::size_t ranks{1};
+    std::shared_ptr<transport> lower{};
+    std::shared_ptr<transport> upper{};
+    TIME sync_interval{1};
+    std::vector<long> cuts{};
+};
+
+/*
+    What make_sharded_grid builds besides the volumes and their shards, each request for more went in here, the defaults change nothing.
+*/
+template<typename TIME, typename REAL, std::size_t DIMS>
+struct grid_settings{
+    //axes that wrap around instead, they need at least 2 volumes and are never open
+    std::array<bool, DIMS> periodic{};
+    //which slab of the grid this process builds, by default all of it, the other slabs are reached through a rank_bridge_model named "bridge"
+    rank_partition<TIME> partition{};
+    //threads each collider shard looks for hits with, see blocking_collider_model::settings_type::threads
+    std::size_t collider_threads{1};
+    //how each pair of species meets, every pair collides the same way by default
+    species_table<TIME, REAL> species{};
+    //handed to every volume and collider, see volume_model::settings_type::coalesce_tolerance, 0 keeps every event at its exact time
+    TIME coalesce_tolerance{0};
+};
+
+/*
+    grid_size   : number of volumes along each axis, volume ids run from 0 to grid_size-1
+    corner      : the low corner of volume {0, ..., 0}
+    volume_size : the extent of every volume, must be positive
+    shard_size  : number of volumes along each axis that one collider shard owns
+    particles   : each one is placed in the volume that contains it, particles outside of the grid go to the nearest edge volume
+    open_edges  : if true, the outermost volumes reach out to infinity so no particle can leave the grid
+    grid        : everything else, see grid_settings, the defaults build the whole grid in one process with nothing extra
+*/
+template<typename TIME, typename REAL, std::size_t DIMS>
+grid_topology<TIME, REAL, DIMS> make_sharded_grid(
+        std::array<long, DIMS> grid_size,
+        std::array<REAL, DIMS> corner,
+        std::array<REAL, DIMS> volume_size,
+        std::array<long, DIMS> shard_size,
+        std::vector<particle<TIME, REAL, DIMS>> particles = {},
+        bool open_edges = true,
+        const grid_settings<TIME, REAL, DIMS>& grid = {}
+    ){
+    using namespace cadmium;
+    using topology = grid_topology<TIME, REAL, DIMS>;
+    using volume_id = std::array<long, DIMS>;
+
+    topology top{};
+    top.grid_size = grid_size;
+    top.volume_size = volume_size;
+    top.species = grid.species;
+
+    auto in_grid = [&](const volume_id& id){
+        bool good = true;
+        for(size_t i = 0; i<DIMS; i++){
+            good &= id[i] >= 0 && id[i] < grid_size[i];
+        }
+        return good;
+    };
+
+    periodic_extent<REAL, DIMS> extent{};
+    for(size_t i = 0; i<DIMS; i++){
+        if(grid.periodic[i]){
+            if(grid_size[i] < 2){
+                throw std::invalid_argument("a periodic axis needs at least 2 volumes");
+            }
+            extent.grid[i] = grid_size[i];
+            extent.length[i] = grid_size[i]*volume_size[i];
+        }
+    }
+    if(grid.periodic[0] && grid.partition.ranks > 1){
+        throw std::invalid_argument("ranks are split along axis 0, which can not also be periodic");
+    }
+
+    auto rank_of = [&](const volume_id& id){
+        if(grid.partition.cuts.size()){
+            return (std::size_t)(std::upper_bound(grid.partition.cuts.begin(), grid.partition.cuts.end(), id[0])-grid.partition.cuts.begin());
+        }
+        return (std::size_t)(id[0]*(long)grid.partition.ranks/grid_size[0]);
+    };
+    auto is_local = [&](const volume_id& id){
+        return rank_of(id) == grid.partition.rank;
+    };
+
+    //enumerate every volume id in the grid, in lexicographic order
+    std::vector<volume_id> ids{};
+    volume_id id{};
+    std::vector<volume_id> all_ids{};
+    while(true){
+        all_ids.push_back(id);
+        size_t i = DIMS;
+        while(i > 0 && id[i-1] == grid_size[i-1]-1){
+            id[i-1] = 0;
+            i--;
+        }
+        if(i == 0){
+            break;
+        }
+        id[i-1]++;
+    }
+    for(const auto& vid : all_ids){
+        if(is_local(vid)){
+            ids.push_back(vid);
+        }
+    }
+
+    //sort the particles into the volumes that hold them
+    std::map<volume_id, std::vector<particle<TIME, REAL, DIMS>>> contents{};
+    for(auto p : particles){
+        //on a periodic axis a particle outside of the grid is really the copy of one inside it
+        for(size_t i = 0; i<DIMS; i++){
+            if(grid.periodic[i]){
+                p.position[i] = corner[i]+std::fmod(std::fmod(p.position[i]-corner[i], extent.length[i])+extent.length[i], extent.length[i]);
+            }
+        }
+        volume_id pid{};
+        for(size_t i = 0; i<DIMS; i++){
+            pid[i] = (long)std::floor((p.position[i]-corner[i])/volume_size[i]);
+            pid[i] = std::clamp(pid[i], 0L, grid_size[i]-1);
+        }
+        if(is_local(pid)){
+            contents[pid].push_back(p);
+        }
+    }
+
+    for(const auto& vid : ids){
+        std::array<REAL, DIMS> one_corner{};
+        std::array<REAL, DIMS> size{};
+        for(size_t i = 0; i<DIMS; i++){
+            one_corner[i] = corner[i]+vid[i]*volume_size[i];
+            size[i] = volume_size[i];
+            const bool open = open_edges && !grid.periodic[i];
+            if(open && grid_size[i] == 1){
+                one_corner[i] = std::numeric_limits<REAL>::infinity();
+            }else if(open && vid[i] == 0){
+                //reach from the high face down to -inf
+                one_corner[i] += volume_size[i];
+                size[i] = -std::numeric_limits<REAL>::infinity();
+            }else if(open && vid[i] == grid_size[i]-1){
+                size[i] = std::numeric_limits<REAL>::infinity();
+            }
+        }
+        typename topology::template volume<TIME>::settings_type settings{};
+        settings.periodic = extent;
+        settings.coalesce_tolerance = grid.coalesce_tolerance;
+        top.volume_names[vid] = volume_name(vid);
+        top.models.push_back(dynamic::translate::make_dynamic_atomic_model<topology::template volume, TIME>(
+            top.volume_names[vid], vid, one_corner, size, contents[vid], settings
+        ));
+    }
+
+    using bridge_defs = rank_bridge_defs<TIME, REAL, DIMS>;
+    const std::string bridge_name = "bridge";
+    const bool bridged = grid.partition.ranks > 1;
+    if(bridged){
+        typename topology::template bridge<TIME>::settings_type settings{};
+        settings.sync_interval = grid.partition.sync_interval;
+        //lower rank first on every rank, so the exchanges pair up without waiting on each other in a circle
+        for(const auto& link_rank : {std::make_pair(grid.partition.lower, grid.partition.rank-1), std::make_pair(grid.partition.upper, grid.partition.rank+1)}){
+            if(link_rank.first){
+                typename topology::template bridge<TIME>::peer_type peer{link_rank.first, {}};
+                for(const auto& vid : all_ids){
+                    if(rank_of(vid) == link_rank.second){
+                        peer.volumes.insert(vid);
+                    }
+                }
+                settings.peers.push_back(peer);
+            }
+        }
+        top.models.push_back(dynamic::translate::make_dynamic_atomic_model<topology::template bridge, TIME>(bridge_name, settings));
+    }
+
+    //particles only ever leave through a face, so only face neighbours need to be coupled
+    //they all share the one particle_leaving port, so each of them gets every block and picks its own out by destination_id
+    for(const auto& vid : ids){
+        bool border = false;
+        //on a periodic axis with 2 volumes both faces lead to the same neighbour, it only gets coupled once
+        std::set<volume_id> faces{};
+        for(size_t i = 0; i<DIMS; i++){
+            for(long step : {-1L, 1L}){
+                volume_id nid = vid;
+                nid[i] += step;
+                nid = wrap_id(extent, nid);
+                if(in_grid(nid) && is_local(nid) && faces.insert(nid).second){
+                    top.ics.push_back(dynamic::translate::make_IC<typename volume_defs<TIME, REAL, DIMS>::particle_leaving, typename volume_defs<TIME, REAL, DIMS>::particle_entering>(top.volume_names[vid], top.volume_names[nid]));
+                }
+            }
+        }
+        for_each_neighbour(vid, extent.grid, [&](const volume_id& nid, const volume_id&){
+            border |= in_grid(nid) && !is_local(nid);
+        });
+        if(bridged && border){
+            top.ics.push_back(dynamic::translate::make_IC<typename volume_defs<TIME, REAL, DIMS>::particle_leaving, typename bridge_defs::particle_leaving>(top.volume_names[vid], bridge_name));
+            top.ics.push_back(dynamic::translate::make_IC<typename bridge_defs::particle_entering, typename volume_defs<TIME, REAL, DIMS>::particle_entering>(bridge_name, top.volume_names[vid]));
+            top.ics.push_back(dynamic::translate::make_IC<typename volume_defs<TIME, REAL, DIMS>::particle_announcement, typename bridge_defs::particle_announcement>(top.volume_names[vid], bridge_name));
+            top.ics.push_back(dynamic::translate::make_IC<typename bridge_defs::remote_delta, typename volume_defs<TIME, REAL, DIMS>::particle_delta>(bridge_name, top.volume_names[vid]));
+        }
+    }
+
+    //group the volumes into shards
+    std::map<volume_id, std::set<volume_id>> shards{};
+    for(const auto& vid : ids){
+        volume_id sid{};
+        for(size_t i = 0; i<DIMS; i++){
+            sid[i] = vid[i]/shard_size[i];
+        }
+        shards[sid].insert(vid);
+    }
+
+    for(const auto& skv : shards){
+        typename topology::template collider<TIME>::settings_type settings{};
+        settings.owned_volumes = skv.second;
+        settings.periodic = extent;
+        settings.threads = grid.collider_threads;
+        settings.species = grid.species;
+        settings.coalesce_tolerance = grid.coalesce_tolerance;
+
+        //the owned volumes and every volume that touches one of them, remote ones are heard through the bridge
+        std::set<volume_id> listened{};
+        bool remote_halo = false;
+        for(const auto& vid : skv.second){
+            for_each_neighbour(vid, extent.grid, [&](const volume_id& nid, const volume_id&){
+                if(in_grid(nid) && is_local(nid)){
+                    listened.insert(nid);
+                }else if(in_grid(nid)){
+                    remote_halo = true;
+                }
+            });
+        }
+
+        const std::string name = volume_name(skv.first, "b_col");
+        top.shard_names[skv.first] = name;
+        top.models.push_back(dynamic::translate::make_dynamic_atomic_model<topology::template collider, TIME>(name, settings));
+
+        for(const auto& vid : listened){
+            top.ics.push_back(dynamic::translate::make_IC<typename volume_defs<TIME, REAL, DIMS>::particle_announcement, typename blocking_defs<TIME, REAL, DIMS>::particle_announcement>(top.volume_names[vid], name));
+            top.ics.push_back(dynamic::translate::make_IC<typename blocking_defs<TIME, REAL, DIMS>::particle_delta, typename volume_defs<TIME, REAL, DIMS>::particle_delta>(name, top.volume_names[vid]));
+        }
+        if(bridged && remote_halo){
+            top.ics.push_back(dynamic::translate::make_IC<typename bridge_defs::ghost_announcement, typename blocking_defs<TIME, REAL, DIMS>::particle_announcement>(bridge_name, name));
+            top.ics.push_back(dynamic::translate::make_IC<typename blocking_defs<TIME, REAL, DIMS>::particle_delta, typename bridge_defs::particle_delta>(name, bridge_name));
+        }
+    }
+
+    return top;
+}
+
+/*
+    An unbounded grid where only the volumes that hold particles exist, see sparse_grid_model, with one blocking collider over all of it.
+    The helpers below work on it the same way as on a full grid, add_sink gets what leaves past settings.low and settings.high.
+    A non zero coalesce_tolerance is handed to the volumes and the collider both, over whatever settings.volume_settings and collider_settings had.
+*/
+template<typename TIME, typename REAL, std::size_t DIMS>
+grid_topology<TIME, REAL, DIMS> make_sparse_grid(
+        typename sparse_grid_model<TIME, REAL, DIMS>::settings_type settings,
+        std::vector<particle<TIME, REAL, DIMS>> particles = {},
+        typename blocking_collider_model<TIME, REAL, DIMS>::settings_type collider_settings = {},
+        TIME coalesce_tolerance = 0
+    ){
+    using namespace cadmium;
+    using topology = grid_topology<TIME, REAL, DIMS>;
+
+    if(settings.volume_settings.periodic.any()){
+        throw std::invalid_argument("a sparse grid has no edges to wrap around");
+    }
+
+    if(coalesce_tolerance > TIME{0}){
+        settings.volume_settings.coalesce_tolerance = coalesce_tolerance;
+        collider_settings.coalesce_tolerance = coalesce_tolerance;
+    }
+
+    topology top{};
+    top.volume_size = settings.volume_size;
+    top.sparse_name = "sparse_grid";
+    top.species = collider_settings.species;
+    top.spills = settings.spill_path.size();
+    top.models.push_back(dynamic::translate::make_dynamic_atomic_model<topology::template sparse_grid, TIME>(top.sparse_name, settings, particles));
+
+    //the one collider owns every volume, a shard's box would have to be fixed up front
+    collider_settings.owned_volumes.clear();
+    const std::string name = "b_col";
+    top.shard_names[{}] = name;
+    top.models.push_back(dynamic::translate::make_dynamic_atomic_model<topology::template collider, TIME>(name, collider_settings));
+    top.ics.push_back(dynamic::translate::make_IC<typename volume_defs<TIME, REAL, DIMS>::particle_announcement, typename blocking_defs<TIME, REAL, DIMS>::particle_announcement>(top.sparse_name, name));
+    top.ics.push_back(dynamic::translate::make_IC<typename blocking_defs<TIME, REAL, DIMS>::particle_delta, typename volume_defs<TIME, REAL, DIMS>::particle_delta>(name, top.sparse_name));
+
+    return top;
+}
+
+/*
+    Adds one long_range_model that listens to, and kicks, every volume of the grid.
+    Only the volumes of this process are seen, a split run does not feel the pull of the particles on other ranks.
+    It can not go on a sparse grid that spills, a spilled volume would stop pulling, and the kicks it should get would be lost.
+*/
+template<typename TIME, typename REAL, std::size_t DIMS>
+void add_long_range(grid_topology<TIME, REAL, DIMS>& top, typename long_range_model<TIME, REAL, DIMS>::settings_type settings, const std::string& name = "long_range"){
+    using namespace cadmium;
+    using topology = grid_topology<TIME, REAL, DIMS>;
+
+    if(top.spills){
+        throw std::invalid_argument("long range forces can not reach the volumes a sparse grid spills, leave spill_path empty");
+    }
+
+    top.models.push_back(dynamic::translate::make_dynamic_atomic_model<topology::template long_range, TIME>(name, settings));
+    for(const auto& volume : top.volume_models()){
+        top.ics.push_back(dynamic::translate::make_IC<typename volume_defs<TIME, REAL, DIMS>::particle_announcement, typename long_range_defs<TIME, REAL, DIMS>::particle_announcement>(volume, name));
+        top.ics.push_back(dynamic::translate::make_IC<typename long_range_defs<TIME, REAL, DIMS>::particle_delta, typename volume_defs<TIME, REAL, DIMS>::particle_delta>(name, volume));
+    }
+}
+
+/*
+    Adds a particle_source_model that feeds settings.volume_id, which has to be one of the volumes of this process.
+    On a sparse grid it can be any volume, it gets made when the first particle comes out.
+*/
+template<typename TIME, typename REAL, std::size_t DIMS>
+void add_source(grid_topology<TIME, REAL, DIMS>& top, typename particle_source_model<TIME, REAL, DIMS>::settings_type settings, const std::string& name = "source"){
+    using namespace cadmium;
+    using topology = grid_topology<TIME, REAL, DIMS>;
+
+    const auto volume = top.sparse_name.size() ? top.sparse_name : top.volume_names.at(settings.volume_id);
+    top.models.push_back(dynamic::translate::make_dynamic_atomic_model<topology::template source, TIME>(name, settings));
+    top.ics.push_back(dynamic::translate::make_IC<typename source_defs<TIME, REAL, DIMS>::particle_created, typename volume_defs<TIME, REAL, DIMS>::particle_entering>(name, volume));
+    top.ics.push_back(dynamic::translate::make_IC<typename volume_defs<TIME, REAL, DIMS>::particle_announcement, typename source_defs<TIME, REAL, DIMS>::particle_announcement>(volume, name));
+}
+
+/*
+    Adds a particle_sink_model that hears every volume of this process that has a face on the outside of the grid.
+    With no outlets given it takes every volume id off the edge of the grid, so it counts everything that leaves, and nothing that only moves between ranks.
+    Only grids without open_edges, and sparse grids with bounds, ever lose particles over the edge.
+*/
+template<typename TIME, typename REAL, std::size_t DIMS>
+void add_sink(grid_topology<TIME, REAL, DIMS>& top, typename particle_sink_model<TIME, REAL, DIMS>::settings_type settings = {}, const std::string& name = "sink"){
+    using namespace cadmium;
+    using topology = grid_topology<TIME, REAL, DIMS>;
+
+    const auto edge_volumes = top.edge_volumes(settings.outlets);
+
+    top.models.push_back(dynamic::translate::make_dynamic_atomic_model<topology::template sink, TIME>(name, settings));
+    for(const auto& volume : edge_volumes){
+        top.ics.push_back(dynamic::translate::make_IC<typename volume_defs<TIME, REAL, DIMS>::particle_leaving, typename sink_defs<TIME, REAL, DIMS>::particle_leaving>(volume, name));
+    }
+}
+
+/*
+    Adds an observer_model that hears every volume of this process, and every collision its collider shards send out.
+    settings.volume_size defaults to the grid's.
+*/
+template<typename TIME, typename REAL, std::size_t DIMS>
+void add_observer(grid_topology<TIME, REAL, DIMS>& top, typename observer_model<TIME, REAL, DIMS>::settings_type settings, const std::string& name = "observer"){
+    using namespace cadmium;
+    using topology = grid_topology<TIME, REAL, DIMS>;
+
+    if(settings.volume_size == std::array<REAL, DIMS>{}){
+        settings.volume_size = top.volume_size;
+    }
+    top.models.push_back(dynamic::translate::make_dynamic_atomic_model<topology::template observer, TIME>(name, settings));
+    for(const auto& volume : top.volume_models()){
+        top.ics.push_back(dynamic::translate::make_IC<typename volume_defs<TIME, REAL, DIMS>::particle_announcement, typename observer_defs<TIME, REAL, DIMS>::particle_announcement>(volume, name));
+    }
+    for(const auto& skv : top.shard_names){
+        top.ics.push_back(dynamic::translate::make_IC<typename blocking_defs<TIME, REAL, DIMS>::particle_delta, typename observer_defs<TIME, REAL, DIMS>::particle_delta>(skv.second, name));
+    }
+}
+
+/*
+    Adds a conservation_auditor_model that hears every volume of this process, and everything that leaves the grid over its edge.
+    Each name in sources is a particle_source_model already in the grid, what it makes is counted as coming in.
+    With no outlets given it counts every volume id off the edge of the grid as gone, like add_sink.
+*/
+template<typename TIME, typename REAL, std::size_t DIMS>
+void add_auditor(grid_topology<TIME, REAL, DIMS>& top, typename conservation_auditor_model<TIME, REAL, DIMS>::settings_type settings = {}, const std::vector<std::string>& sources = {}, const std::string& name = "auditor"){
+    using namespace cadmium;
+    using topology = grid_topology<TIME, REAL, DIMS>;
+
+    const auto edge_volumes = top.edge_volumes(settings.outlets);
+
+    top.models.push_back(dynamic::translate::make_dynamic_atomic_model<topology::template auditor, TIME>(name, settings));
+    for(const auto& volume : top.volume_models()){
+        top.ics.push_back(dynamic::translate::make_IC<typename volume_defs<TIME, REAL, DIMS>::particle_announcement, typename auditor_defs<TIME, REAL, DIMS>::particle_announcement>(volume, name));
+    }
+    for(const auto& volume : edge_volumes){
+        top.ics.push_back(dynamic::translate::make_IC<typename volume_defs<TIME, REAL, DIMS>::particle_leaving, typename auditor_defs<TIME, REAL, DIMS>::outflow>(volume, name));
+    }
+    for(const auto& source : sources){
+        top.ics.push_back(dynamic::translate::make_IC<typename source_defs<TIME, REAL, DIMS>::particle_created, typename auditor_defs<TIME, REAL, DIMS>::inflow>(source, name));
+    }
+}
+
+/*
+    Adds a snapshot_model that keeps snapshot pointed at every volume of this process.
+    Only the volumes are heard, so the snapshot is as good as the last step the runner finished.
+    It can not go on a sparse grid that spills, the particles of a spilled volume are not in memory to be pointed at.
+*/
+template<typename TIME, typename REAL, std::size_t DIMS>
+void add_snapshot(grid_topology<TIME, REAL, DIMS>& top, std::shared_ptr<particle_snapshot<TIME, REAL, DIMS>> snapshot, const std::string& name = "snapshot"){
+    using namespace cadmium;
+    using topology = grid_topology<TIME, REAL, DIMS>;
+
+    if(top.spills){
+        throw std::invalid_argument("a snapshot can not see the volumes a sparse grid spills, leave spill_path empty");
+    }
+
+    top.models.push_back(dynamic::translate::make_dynamic_atomic_model<topology::template snapshot, TIME>(name, typename snapshot_model<TIME, REAL, DIMS>::settings_type{std::move(snapshot)}));
+    for(const auto& volume : top.volume_models()){
+        top.ics.push_back(dynamic::translate::make_IC<typename volume_defs<TIME, REAL, DIMS>::particle_announcement, typename snapshot_defs<TIME, REAL, DIMS>::particle_announcement>(volume, name));
+    }
+}
+
+/*
+    Adds a soft_contact_model that hears every volume of this process and every hit its collider shards send out,
+    and tells every shard which volumes it has taken off them.
+    It gets the species table the shards were made with, over whatever settings.species had, so the two always agree about which pairs touch.
+*/
+template<typename TIME, typename REAL, std::size_t DIMS>
+void add_soft_contact(grid_topology<TIME, REAL, DIMS>& top, typename soft_contact_model<TIME, REAL, DIMS>::settings_type settings = {}, const std::string& name = "soft_contact"){
+    using namespace cadmium;
+    using topology = grid_topology<TIME, REAL, DIMS>;
+
+    settings.species = top.species;
+    top.models.push_back(dynamic::translate::make_dynamic_atomic_model<topology::template soft_contact, TIME>(name, settings));
+    for(const auto& volume : top.volume_models()){
+        top.ics.push_back(dynamic::translate::make_IC<typename volume_defs<TIME, REAL, DIMS>::particle_announcement, typename soft_contact_defs<TIME, REAL, DIMS>::particle_announcement>(volume, name));
+        top.ics.push_back(dynamic::translate::make_IC<typename soft_contact_defs<TIME, REAL, DIMS>::particle_delta, typename volume_defs<TIME, REAL, DIMS>::particle_delta>(name, volume));
+    }
+    for(const auto& skv : top.shard_names){
+        top.ics.push_back(dynamic::translate::make_IC<typename blocking_defs<TIME, REAL, DIMS>::particle_delta, typename soft_contact_defs<TIME, REAL, DIMS>::collider_delta>(skv.second, name));
+        top.ics.push_back(dynamic::translate::make_IC<typename soft_contact_defs<TIME, REAL, DIMS>::contact_region, typename blocking_defs<TIME, REAL, DIMS>::contact_region>(name, skv.second));
+    }
+}
+
+}
+#endif /* __GRID_TOPOLOGY_HPP__ */
@@ -0,0 +1,120 @@
+#ifndef __LOG_FILTER_HPP__
+#define __LOG_FILTER_HPP__
+
+#include <cstddef>
+#include <array>
+#include <vector>
+#include <set>
+#include <string>
+#include <limits>
+
+namespace tps{
+
+/*
+    What the loggers should write, everything by default.
+    Each filtered_logger is handed its own through a type, the way the loggers are handed their sinks, set it up before the runner starts.
+
+    Whole steps are let through or skipped by filtered_logger (see filtered_logger.hpp), every every-th step with a time in [from, until],
+    and so are whole models, by the id they were given. filtered_logger closes the filter for a model that is left out before Cadmium
+    gets to formatting its messages and state, so none of it is formatted, and none of its records are written, not even as an empty one.
+    Inside a model that is let through, the messages and volume states only print the volumes in [volume_low, volume_high],
+    the particles in particles or species, and the message types that are not muted.
+    All of the printing in this repo checks the filter before it formats anything, so what is filtered out costs next to nothing.
+    A message that is filtered out prints as nothing, Cadmium still prints the separator around it, atps_output_tools.py skips the gaps.
+    With keyframe_every set, a volume's record between keyframes is just the particles its pending lists hold, what it is about to announce,
+    so a volume that cleared those in a step or model that is skipped writes a keyframe instead.
+*/
+struct log_filter{
+    /* which steps */
+    double from{-std::numeric_limits<double>::infinity()};
+    double until{std::numeric_limits<double>::infinity()};
+    std::size_t every{1};
+
+    /* which models, by id, empty lets every model through */
+    std::set<std::string> models{};
+
+    /* which volumes, an empty bound lets everything through on that side */
+    std::vector<long> volume_low{};
+    std::vector<long> volume_high{};
+
+    /* which particles, a particle gets through if either set is empty or has it */
+    std::set<std::size_t> particles{};
+    std::set<std::size_t> species{};
+
+    /* which messages */
+    bool announcements{true};
+    bool deltas{true};
+    bool moves{true};
+    bool observables{true};
+    bool states{true};
+
+    /* how volume states are written, 0 writes every particle each time,
+       n writes every particle only each n-th time a volume is written, a keyframe, and just the particles that changed since its last record in between
+       with steps skipped, a volume that moved while nothing was written starts again with a keyframe */
+    std::size_t keyframe_every{0};
+
+    /* kept up to date by filtered_logger as each step starts, before any model in it is logged */
+    bool step_open{true};
+    std::size_t steps{0};
+
+    void start_step(double t){
+        step_open = t >= from && t <= until && steps % every == 0;
+        steps++;
+    }
+
+    bool lets_model(const std::string& model_id) const {
+        return step_open && (models.empty() || models.count(model_id));
+    }
+
+    //true if anything is filtered out inside a step, and not just whole steps
+    bool narrows() const {
+        return models.size() || volume_low.size() || volume_high.size() || particles.size() || species.size()
+            || !announcements || !deltas || !moves || !observables || !states;
+    }
+
+    template<std::size_t DIMS>
+    bool volume(const std::array<long, DIMS>& volume_id) const {
+        for(std::size_t i = 0; i<DIMS; i++){
+            if((i < volume_low.size() && volume_id[i] < volume_low[i]) || (i < volume_high.size() && volume_id[i] > volume_high[i])){
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool particle(std::size_t id, std::size_t particle_species) const {
+        if(particles.empty() && species.empty()){
+            return true;
+        }
+        return particles.count(id) || species.count(particle_species);
+    }
+
+    //for records that only carry an id, a species filter on its own lets them all through
+    bool particle_id(std::size_t id) const {
+        return particles.empty() || particles.count(id);
+    }
+};
+
+/*
+    What the printing code goes by, the filter of the filtered_logger that last logged on this thread, and whether the model it is on is let through.
+    Cadmium formats messages and states itself, between its calls to the logger, so the filter can not be handed to the printing code, it looks here.
+    Each thread has its own, so neither the threads of a parallel runner nor runners on threads of their own see each other's models,
+    and outside of a filtered_logger everything is let through.
+*/
+struct log_view{
+    const log_filter* filter{nullptr};
+    bool open{true};
+
+    const log_filter& rules() const {
+        static const log_filter everything{};
+        return filter ? *filter : everything;
+    }
+};
+
+inline log_view& current_log_view(){
+    thread_local log_view view{};
+    return view;
+}
+
+}
+#endif /* __LOG_FILTER_HPP__ */
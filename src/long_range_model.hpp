@@ -0,0 +1,356 @@
+#ifndef __LONG_RANGE_MODEL_HPP__
+#define __LONG_RANGE_MODEL_HPP__
+
+
+#include <cadmium/modeling/ports.hpp>
+#include <cadmium/modeling/message_bag.hpp>
+
+#include <map>
+#include <set>
+#include <vector>
+#include <cmath>
+#include <limits>
+#include <algorithm>
+
+#include "./particle.hpp"
+#include "./particle_delta_message.hpp"
+#include "./particle_announcement_message.hpp"
+#include "./barnes_hut_tree.hpp"
+#include "./volume_neighbours.hpp"
+
+namespace tps{
+
+template<typename TIME, typename REAL, std::size_t DIMS>
+struct long_range_defs{
+
+    struct particle_announcement    : public cadmium::in_port<particle_announcement_message<TIME, REAL, DIMS>> {};
+
+    struct particle_delta           : public cadmium::out_port<particle_delta_message<TIME, REAL, DIMS>> {};
+
+};
+
+/*
+    Pulls (or pushes) every particle it hears about towards every other one, with a force of coupling*q_i*q_j/r^2 along the line between them.
+    Gravity is coupling = G with the masses as charges, which is what an empty species_charge gives. Like charges repel with a negative coupling.
+
+    It listens to volumes the same way a collider does, and nudges particles with plain velocity kicks, at most every max_interval.
+    Each particle gets kicked on its own clock, halved as many times as it takes for one kick to move it by about accuracy^2 of its radius
+    (or of softening if that is bigger), so particles in tight spots get kicked often and lonely ones rarely.
+    The clocks are all max_interval/2^k, and line up with each other, so the particles that are due at once are all kicked off the same tree.
+
+    Past its own volume and the volumes next to it, a particle only feels each volume as one charge at the volume's centre of charge.
+    Those totals are kept up to date from the particles each announcement says changed or left, the way the observer keeps its sums,
+    and carried forward in time with the volume's mean velocity, which is exact until something in it is kicked or hit, and then it announces anyway.
+    Each sweep builds one tree, in the same storage as last time, with the volumes around the due particles opened up into their particles and every other volume as one body.
+    Every due particle reads its whole field off that tree, so the particles near it cost log n each like everything else, and theta = 0 is exact down to the volume.
+    Only the particles that are due are looked at, off the front of a queue ordered by when they are due.
+
+    Each kick is the force where the particle is now, held for its whole interval. That is first order, so keep accuracy small.
+    The field is worked out in open space, periodic axes are not wrapped.
+*/
+template<typename TIME, typename REAL, std::size_t DIMS>
+struct long_range_model{
+    struct settings_type{
+        //how big a tree node can look before it is opened, 0 is the exact sum
+        REAL theta{0.5};
+        REAL coupling{1};
+        //charge of each species, if this is empty every particle's mass is its charge, and a species that is missing has no charge
+        std::map<std::size_t, REAL> species_charge{};
+        //stops the force blowing up when two particles get close, collisions should keep them apart anyway
+        REAL softening{0};
+
+        TIME max_interval{1};
+        std::size_t max_halvings{20};
+        REAL accuracy{0.1};
+    };
+    settings_type settings;
+
+    //what a volume's particles add up to, or what one particle adds to its volume
+    struct totals_type{
+        std::size_t count{0};
+        REAL charge{0};
+        REAL weight{0};                                 //sum of |charge|
+        //sum of |q|*(x-v*last_updated) and of |q|*v, so the centre of charge at t is (at_zero+t*drift)/weight
+        std::array<REAL, DIMS> at_zero{};
+        std::array<REAL, DIMS> drift{};
+
+        void add(const totals_type& other, int sign){
+            count = sign > 0 ? count+other.count : count-other.count;
+            charge += sign*other.charge;
+            weight += sign*other.weight;
+            for(std::size_t i = 0; i<DIMS; i++){
+                at_zero[i] += sign*other.at_zero[i];
+                drift[i] += sign*other.drift[i];
+            }
+            if(!count){
+                //nothing left in it, so anything else is rounding
+                *this = {};
+            }
+        }
+    };
+
+    //what the rest of the domain sees of a volume, from its last announcement
+    struct volume_entry{
+        //the live particle map
+        const std::map<std::size_t, particle<TIME, REAL, DIMS>>* particles{nullptr};
+        totals_type totals{};
+        std::size_t opened{0};                          //the last sweep its particles went into the tree one by one
+    };
+
+    struct state_type{
+        TIME global_time{0};
+        std::vector<particle_delta_message<TIME, REAL, DIMS>> pending_deltas{};
+
+        std::map<std::array<long, DIMS>, volume_entry> volumes{};
+        //which volume each particle was last announced by, and what it added to that volume's totals
+        std::map<std::size_t, std::pair<std::array<long, DIMS>, totals_type>> shares{};
+        //when each particle is next due a kick, and the same again soonest first
+        std::map<std::size_t, TIME> next_kick{};
+        std::set<std::pair<TIME, std::size_t>> kick_queue{};
+        TIME next_internal_time{std::numeric_limits<TIME>::infinity()};
+
+        //scratch space for sweeps, kept here so it does not go back to the heap every sweep
+        barnes_hut_tree<REAL, DIMS> tree{};
+        std::vector<std::size_t> due{};
+        //the body of each particle that went into the tree one by one, sorted by id
+        std::vector<std::pair<std::size_t, std::size_t>> particle_bodies{};
+        std::vector<std::size_t> skip{};
+
+        std::size_t sweeps{0};
+        std::size_t kicks{0};
+
+        friend std::ostream& operator<<(std::ostream& os, const state_type& state) {
+            return os << "{\"sweeps\":" << state.sweeps << ", \"kicks\":" << state.kicks << "}";
+        }
+    };
+    state_type state;
+
+    using input_ports = std::tuple<
+        typename long_range_defs<TIME, REAL, DIMS>::particle_announcement
+    >;
+
+    using output_ports = std::tuple<
+        typename long_range_defs<TIME, REAL, DIMS>::particle_delta
+    >;
+
+    long_range_model<TIME, REAL, DIMS>(){};
+    long_range_model<TIME, REAL, DIMS>(settings_type settings) : settings(std::move(settings)) {};
+
+    REAL charge_of(const particle<TIME, REAL, DIMS>& par) const {
+        if(settings.species_charge.empty()){
+            return par.mass;
+        }
+        auto it = settings.species_charge.find(par.species);
+        return it == settings.species_charge.end() ? REAL{0} : it->second;
+    }
+
+    //the interval for a particle feeling acceleration a, max_interval halved until a kick moves it by no more than accuracy^2*length
+    TIME interval_for(REAL a, REAL length) const {
+        TIME dt = settings.max_interval;
+        for(std::size_t k = 0; k<settings.max_halvings && a*dt*dt > settings.accuracy*settings.accuracy*length; k++){
+            dt /= 2;
+        }
+        return dt;
+    }
+
+    typename cadmium::make_message_bags<output_ports>::type output() const {
+        typename cadmium::make_message_bags<output_ports>::type bag;
+
+        auto& deltas = cadmium::get_messages<typename long_range_defs<TIME, REAL, DIMS>::particle_delta>(bag);
+        deltas.insert(deltas.end(), state.pending_deltas.begin(), state.pending_deltas.end());
+
+        return bag;
+    }
+
+    //what one particle adds to the totals of its volume
+    totals_type share_of(const particle<TIME, REAL, DIMS>& par) const {
+        totals_type share{};
+        const REAL q = charge_of(par);
+        share.count = 1;
+        share.charge = q;
+        share.weight = std::abs(q);
+        for(std::size_t i = 0; i<DIMS; i++){
+            share.at_zero[i] = std::abs(q)*(par.position[i]-par.velocity[i]*par.last_updated);
+            share.drift[i] = std::abs(q)*par.velocity[i];
+        }
+        return share;
+    }
+
+    void sweep(){
+        const TIME t = state.global_time;
+        auto& tree = state.tree;
+        state.sweeps++;
+
+        state.due.clear();
+        while(state.kick_queue.size() && state.kick_queue.begin()->first <= t){
+            state.due.push_back(state.kick_queue.begin()->second);
+            state.kick_queue.erase(state.kick_queue.begin());
+        }
+
+        //the volumes around every due particle go into the tree one particle at a time
+        for(const auto id : state.due){
+            auto share_it = state.shares.find(id);
+            if(share_it == state.shares.end()){
+                continue;
+            }
+            for_each_neighbour(share_it->second.first, [&](const std::array<long, DIMS>& nid){
+                auto nit = state.volumes.find(nid);
+                if(nit != state.volumes.end()){
+                    nit->second.opened = state.sweeps;
+                }
+            });
+        }
+
+        //every other volume is one body, at where its centre of charge has got to by now
+        tree.clear();
+        state.particle_bodies.clear();
+        for(auto& vkv : state.volumes){
+            const auto& entry = vkv.second;
+            if(entry.opened == state.sweeps){
+                for(const auto& pkv : *entry.particles){
+                    state.particle_bodies.push_back({pkv.first, tree.bodies.size()});
+                    tree.bodies.push_back({advance_to_time(pkv.second, t).position, charge_of(pkv.second)});
+                }
+                continue;
+            }
+            const auto& totals = entry.totals;
+            std::array<REAL, DIMS> centre{};
+            for(std::size_t i = 0; i<DIMS; i++){
+                centre[i] = totals.weight > REAL{0} ? (totals.at_zero[i]+t*totals.drift[i])/totals.weight : REAL{0};
+            }
+            tree.bodies.push_back({centre, totals.charge});
+        }
+        std::sort(state.particle_bodies.begin(), state.particle_bodies.end());
+        tree.build();
+
+        for(const auto id : state.due){
+            //a particle that is in none of the volumes has left them all, the one it lands in will announce it again
+            auto share_it = state.shares.find(id);
+            auto vol_it = share_it == state.shares.end() ? state.volumes.end() : state.volumes.find(share_it->second.first);
+            if(vol_it == state.volumes.end() || !vol_it->second.particles->count(id)){
+                state.next_kick.erase(id);
+                continue;
+            }
+            const auto par = advance_to_time(vol_it->second.particles->at(id), t);
+
+            const REAL q = charge_of(par);
+            std::array<REAL, DIMS> a{};
+            REAL a2 = 0;
+            if(q != REAL{0}){
+                //everything but itself, its volume was opened so it is a body of its own
+                state.skip.assign(1, std::lower_bound(state.particle_bodies.begin(), state.particle_bodies.end(), std::make_pair(id, std::size_t{0}))->second);
+                const auto f = tree.field(par.position, state.skip, settings.theta, settings.softening);
+                for(std::size_t i = 0; i<DIMS; i++){
+                    a[i] = settings.coupling*q*f[i]/par.mass;
+                    a2 += a[i]*a[i];
+                }
+            }
+
+            //line the next kick up with every other clock of the same interval
+            const TIME dt = interval_for(std::sqrt(a2), std::max(par.radius, settings.softening));
+            const TIME next = (std::floor(t/dt)+1)*dt;
+            state.next_kick[id] = next;
+            state.kick_queue.insert({next, id});
+
+            if(a2 > REAL{0}){
+                particle_delta_message<TIME, REAL, DIMS> kick{};
+                kick.volume_id = vol_it->first;
+                kick.particle_id = par.id;
+                for(std::size_t i = 0; i<DIMS; i++){
+                    kick.dv[i] = a[i]*(next-t);
+                }
+                kick.deferred_dv_time = std::numeric_limits<TIME>::infinity();
+                state.pending_deltas.push_back(kick);
+                state.kicks++;
+            }
+        }
+    }
+
+    void update_next_internal_time(){
+        state.next_internal_time = state.kick_queue.empty() ? std::numeric_limits<TIME>::infinity() : state.kick_queue.begin()->first;
+    }
+
+    void internal_transition(){
+        state.global_time += time_advance();
+
+        //We just got here from the output function, we can clear the queued deltas.
+        state.pending_deltas.clear();
+
+        if(state.next_internal_time <= state.global_time){
+            sweep();
+            update_next_internal_time();
+        }
+    }
+
+    void external_transition(TIME dt, typename cadmium::make_message_bags<input_ports>::type mbs) {
+        state.global_time += dt;
+        for(const auto& msg : cadmium::get_messages<typename long_range_defs<TIME, REAL, DIMS>::particle_announcement>(mbs)){
+            //a particle that has moved on is taken out here, unless the volume it went to has already taken it
+            for(const auto id : *msg.particle_removed){
+                auto it = state.shares.find(id);
+                if(it != state.shares.end() && it->second.first == msg.volume_id){
+                    auto vit = state.volumes.find(msg.volume_id);
+                    if(vit != state.volumes.end()){
+                        vit->second.totals.add(it->second.second, -1);
+                    }
+                    state.shares.erase(it);
+                }
+            }
+            if(msg.volume_update->empty()){
+                //a volume that emptied out has nothing to pull on, its particles' clocks are dropped when they come due
+                state.volumes.erase(msg.volume_id);
+                continue;
+            }
+            auto& entry = state.volumes[msg.volume_id];
+            entry.particles = msg.volume_update;
+            //a changed particle comes out of wherever it was counted before, and goes in again as it is now
+            for(const auto id : *msg.particle_changed){
+                auto par_it = msg.volume_update->find(id);
+                if(par_it == msg.volume_update->end()){
+                    continue;
+                }
+                auto it = state.shares.find(id);
+                if(it != state.shares.end()){
+                    auto vit = state.volumes.find(it->second.first);
+                    if(vit != state.volumes.end()){
+                        vit->second.totals.add(it->second.second, -1);
+                    }
+                }
+                const auto share = share_of(par_it->second);
+                entry.totals.add(share, 1);
+                state.shares[id] = {msg.volume_id, share};
+                //anything we have not seen yet is due a kick straight away, that is how its clock gets started
+                if(state.next_kick.emplace(id, state.global_time).second){
+                    state.kick_queue.insert({state.global_time, id});
+                }
+            }
+        }
+        update_next_internal_time();
+    }
+
+    void confluence_transition(TIME, typename cadmium::make_message_bags<input_ports>::type mbs) {
+        internal_transition();
+        external_transition(TIME{}, std::move(mbs));
+    }
+
+
+    TIME time_advance() const {
+        if(state.pending_deltas.size()){
+            return {0};
+        }else{
+            return std::max(state.next_internal_time-state.global_time, {0});
+        }
+    }
+
+
+    friend std::ostream& operator<<(std::ostream& os, const long_range_model& lrm) {
+        return os << lrm.state;
+    }
+
+
+};
+
+
+
+}
+#endif /* __LONG_RANGE_MODEL_HPP__ */
@@ -0,0 +1,42 @@
+#ifndef __MORTON_ORDER_HPP__
+#define __MORTON_ORDER_HPP__
+
+#include <array>
+#include <cstddef>
+#include <climits>
+
+namespace tps{
+
+/*
+    Orders volume ids along a Morton (z-order) curve instead of lexicographically, so ids that are close in space are mostly close in the order too.
+    A map keyed with this keeps a volume's neighbours in nearby nodes, and a list sorted with it visits space one small block at a time.
+    The bits are never interleaved, the axis whose two coordinates differ in the highest bit decides, which comes out the same.
+*/
+template<std::size_t DIMS>
+struct morton_less{
+    //flipping the sign bit keeps the order of the coordinates, with negative ones below the rest
+    static unsigned long biased(long x){
+        return (unsigned long)x ^ (1ul << (sizeof(long)*CHAR_BIT-1));
+    }
+
+    //true if the highest set bit of lhs is below the highest set bit of rhs
+    static bool lower_msb(unsigned long lhs, unsigned long rhs){
+        return lhs < rhs && lhs < (lhs ^ rhs);
+    }
+
+    bool operator()(const std::array<long, DIMS>& lhs, const std::array<long, DIMS>& rhs) const {
+        std::size_t axis = 0;
+        unsigned long highest = 0;
+        for(size_t i = 0; i<DIMS; i++){
+            const unsigned long diff = biased(lhs[i]) ^ biased(rhs[i]);
+            if(lower_msb(highest, diff)){
+                axis = i;
+                highest = diff;
+            }
+        }
+        return biased(lhs[axis]) < biased(rhs[axis]);
+    }
+};
+
+}
+#endif /* __MORTON_ORDER_HPP__ */
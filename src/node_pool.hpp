@@ -0,0 +1,89 @@
+#ifndef __NODE_POOL_HPP__
+#define __NODE_POOL_HPP__
+
+#include <cstddef>
+#include <vector>
+#include <utility>
+
+namespace tps{
+
+/*
+    Keeps the nodes of a std::map or std::set that were taken out of it, so they can be put back in later without going to the heap.
+    Particles move in and out of volumes all the time, so after a short warm up every insert should be a reuse.
+    allocations and reuses count how often each path was taken, allocations should stop growing once a run reaches steady state.
+*/
+template<typename MAP>
+struct node_pool{
+    using node_type = typename MAP::node_type;
+
+    std::vector<node_type> spare{};
+    std::size_t allocations{0};
+    std::size_t reuses{0};
+
+    node_pool() = default;
+    node_pool(node_pool&&) = default;
+    node_pool& operator=(node_pool&&) = default;
+
+    //node handles can not be copied, so a copied pool starts out with no spare nodes
+    node_pool(const node_pool& other) : allocations(other.allocations), reuses(other.reuses) {}
+    node_pool& operator=(const node_pool& other){
+        spare.clear();
+        allocations = other.allocations;
+        reuses = other.reuses;
+        return *this;
+    }
+
+    void release(MAP& map, const typename MAP::key_type& key){
+        auto node = map.extract(key);
+        if(node){
+            spare.push_back(std::move(node));
+        }
+    }
+
+    //hands back a spare node, or an empty node handle if there are none left
+    node_type take(){
+        if(spare.size()){
+            node_type node = std::move(spare.back());
+            spare.pop_back();
+            reuses++;
+            return node;
+        }
+        return node_type{};
+    }
+
+    template<typename M = MAP>
+    typename M::mapped_type& insert_or_assign(M& map, const typename M::key_type& key, const typename M::mapped_type& value){
+        auto it = map.find(key);
+        if(it != map.end()){
+            it->second = value;
+            return it->second;
+        }
+        node_type node = take();
+        if(node){
+            node.key() = key;
+            node.mapped() = value;
+            return map.insert(std::move(node)).position->second;
+        }
+        allocations++;
+        return map.emplace(key, value).first->second;
+    }
+
+    //the same for a std::set
+    template<typename S = MAP>
+    void insert(S& set, const typename S::key_type& key){
+        if(set.count(key)){
+            return;
+        }
+        node_type node = take();
+        if(node){
+            node.value() = key;
+            set.insert(std::move(node));
+            return;
+        }
+        allocations++;
+        set.insert(key);
+    }
+};
+
+}
+#endif /* __NODE_POOL_HPP__ */
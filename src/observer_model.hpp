@@ -0,0 +1,274 @@
+#ifndef __OBSERVER_MODEL_HPP__
+#define __OBSERVER_MODEL_HPP__
+
+
+#include <cadmium/modeling/ports.hpp>
+#include <cadmium/modeling/message_bag.hpp>
+
+#include <map>
+#include <vector>
+#include <cmath>
+#include <limits>
+#include <algorithm>
+
+#include "./particle.hpp"
+#include "./particle_delta_message.hpp"
+#include "./particle_announcement_message.hpp"
+#include "./volume_observables_message.hpp"
+
+namespace tps{
+
+template<typename TIME, typename REAL, std::size_t DIMS>
+struct observer_defs{
+
+    struct particle_announcement    : public cadmium::in_port<particle_announcement_message<TIME, REAL, DIMS>> {};
+    struct particle_delta           : public cadmium::in_port<particle_delta_message<TIME, REAL, DIMS>> {};
+
+    struct observables              : public cadmium::out_port<volume_observables_message<TIME, REAL, DIMS>> {};
+
+};
+
+/*
+    Turns the run into a time series of per volume aggregates, so a run that only needs those does not have to log every announcement.
+    It listens to the volumes for their particles, and to the colliders for every collision they send out.
+    Every interval it sends one volume_observables_message for each volume it has heard from.
+
+    Pressure is the virial one, (count*temperature + sum of (x-c).J/(DIMS*interval))/volume, where J is the momentum a collision gives a particle at x,
+    and c is the point where the two touch. The two (x-c).J of a pair add up to the pair's (x_1-x_2).J_1, but each only needs its own particle,
+    so the deltas do not have to be matched up, and a pair split between two volumes gives each its share.
+    For spheres J is along x-c, which makes (x-c).J = radius*|J|.
+    The edge volumes of an open grid reach out to infinity, they are counted as if they were volume_size anyway.
+
+    The sums behind each sample are kept up as the volumes announce, from what each changed particle added last time, so a sample costs
+    one step per volume, not per particle. A deferred dv counts as already landed, like conservation_auditor_model does, so a collision
+    that is still sticking does not show up as a dip in temperature.
+*/
+template<typename TIME, typename REAL, std::size_t DIMS>
+struct observer_model{
+    struct settings_type{
+        TIME interval{1};
+        std::array<REAL, DIMS> volume_size{};
+    };
+    settings_type settings;
+
+    struct window_type{
+        std::size_t collisions{0};
+        REAL virial{0};
+    };
+
+    //what one particle adds to its volume's sums, or all of a volume's particles together
+    struct sums_type{
+        std::size_t count{0};
+        REAL mass{0};
+        std::array<REAL, DIMS> momentum{};
+        REAL mv2{0};                                //sum of m|v|^2
+
+        void add(const sums_type& other, int sign){
+            count = sign > 0 ? count+other.count : count-other.count;
+            mass += sign*other.mass;
+            for(size_t i = 0; i<DIMS; i++){
+                momentum[i] += sign*other.momentum[i];
+            }
+            mv2 += sign*other.mv2;
+            if(!count){
+                //nothing left in it, so anything else is rounding
+                *this = {};
+            }
+        }
+    };
+
+    static sums_type share_of(const particle<TIME, REAL, DIMS>& par){
+        sums_type share{};
+        share.count = 1;
+        share.mass = par.mass;
+        for(size_t i = 0; i<DIMS; i++){
+            const REAL v = par.velocity[i]+(par.deferred_dv_time != std::numeric_limits<TIME>::infinity() ? par.deferred_dv[i] : REAL{0});
+            share.momentum[i] = par.mass*v;
+            share.mv2 += par.mass*v*v;
+        }
+        return share;
+    }
+
+    struct state_type{
+        TIME global_time{0};
+        TIME next_sample{0};
+        std::vector<volume_observables_message<TIME, REAL, DIMS>> pending_observables{};
+
+        //the live particle map of each volume, from its last announcement
+        std::map<std::array<long, DIMS>, const std::map<std::size_t, particle<TIME, REAL, DIMS>>*> volumes{};
+        std::map<std::array<long, DIMS>, window_type> windows{};
+        std::map<std::array<long, DIMS>, sums_type> sums{};
+        //which volume's sums each particle is in, and what it added to them
+        std::map<std::size_t, std::pair<std::array<long, DIMS>, sums_type>> shares{};
+
+        std::size_t samples{0};
+
+        friend std::ostream& operator<<(std::ostream& os, const state_type& state) {
+            return os << "{\"samples\":" << state.samples << "}";
+        }
+    };
+    state_type state;
+
+    using input_ports = std::tuple<
+        typename observer_defs<TIME, REAL, DIMS>::particle_announcement,
+        typename observer_defs<TIME, REAL, DIMS>::particle_delta
+    >;
+
+    using output_ports = std::tuple<
+        typename observer_defs<TIME, REAL, DIMS>::observables
+    >;
+
+    observer_model<TIME, REAL, DIMS>(){};
+    observer_model<TIME, REAL, DIMS>(settings_type settings) : settings(std::move(settings)) {
+        state.next_sample = this->settings.interval;
+    };
+
+    typename cadmium::make_message_bags<output_ports>::type output() const {
+        typename cadmium::make_message_bags<output_ports>::type bag;
+
+        auto& observables = cadmium::get_messages<typename observer_defs<TIME, REAL, DIMS>::observables>(bag);
+        observables.insert(observables.end(), state.pending_observables.begin(), state.pending_observables.end());
+
+        return bag;
+    }
+
+    void sample(){
+        REAL measure = 1;
+        for(size_t i = 0; i<DIMS; i++){
+            measure *= settings.volume_size[i];
+        }
+
+        for(const auto& skv : state.sums){
+            const auto& sums = skv.second;
+            volume_observables_message<TIME, REAL, DIMS> obs{};
+            obs.time = state.global_time;
+            obs.volume_id = skv.first;
+            obs.count = sums.count;
+            obs.mass = sums.mass;
+            obs.momentum = sums.momentum;
+
+            //the temperature is taken in the frame the volume is moving in, so a steady flow through it is not heat
+            //sum of m|v-V|^2 is sum of m|v|^2 less M|V|^2
+            REAL thermal = 0;
+            if(obs.mass > REAL{0}){
+                REAL p2 = 0;
+                for(size_t i = 0; i<DIMS; i++){
+                    p2 += obs.momentum[i]*obs.momentum[i];
+                }
+                thermal = std::max(sums.mv2-p2/obs.mass, REAL{0});
+            }
+            obs.temperature = obs.count ? thermal/(DIMS*obs.count) : REAL{0};
+            obs.density = measure > REAL{0} ? obs.count/measure : REAL{0};
+
+            auto& window = state.windows[skv.first];
+            obs.collisions = window.collisions;
+            obs.pressure = measure > REAL{0} ? (thermal/DIMS + window.virial/(DIMS*settings.interval))/measure : REAL{0};
+            window = {};
+
+            state.pending_observables.push_back(obs);
+        }
+        state.samples++;
+    }
+
+    void internal_transition(){
+        state.global_time += time_advance();
+
+        //We just got here from the output function, we can clear what it sent
+        if(state.pending_observables.size()){
+            state.pending_observables.clear();
+            return;
+        }
+
+        if(state.global_time >= state.next_sample){
+            sample();
+            state.next_sample += settings.interval;
+        }
+    }
+
+    void external_transition(TIME dt, typename cadmium::make_message_bags<input_ports>::type mbs) {
+        state.global_time += dt;
+
+        for(const auto& msg : cadmium::get_messages<typename observer_defs<TIME, REAL, DIMS>::particle_announcement>(mbs)){
+            //an empty volume may be dropped by a sparse grid, so its map is not kept, it still samples as empty
+            static const std::map<std::size_t, particle<TIME, REAL, DIMS>> no_particles{};
+            state.volumes[msg.volume_id] = msg.volume_update->empty() ? &no_particles : msg.volume_update;
+            auto& sums = state.sums[msg.volume_id];
+
+            //a particle that has moved on is taken out here, unless the volume it went to has already taken it
+            for(const auto id : *msg.particle_removed){
+                auto it = state.shares.find(id);
+                if(it != state.shares.end() && it->second.first == msg.volume_id){
+                    sums.add(it->second.second, -1);
+                    state.shares.erase(it);
+                }
+            }
+            //a changed particle comes out of wherever it was counted before, and goes in again as it is now
+            for(const auto id : *msg.particle_changed){
+                auto par_it = msg.volume_update->find(id);
+                if(par_it == msg.volume_update->end()){
+                    continue;
+                }
+                auto it = state.shares.find(id);
+                if(it != state.shares.end()){
+                    state.sums[it->second.first].add(it->second.second, -1);
+                }
+                const auto share = share_of(par_it->second);
+                sums.add(share, 1);
+                state.shares[id] = {msg.volume_id, share};
+            }
+        }
+
+        for(const auto& delta_msg : cadmium::get_messages<typename observer_defs<TIME, REAL, DIMS>::particle_delta>(mbs)){
+            //a kick with no deferred dv is not a collision
+            if(delta_msg.deferred_dv_time == std::numeric_limits<TIME>::infinity()){
+                continue;
+            }
+            auto vkv = state.volumes.find(delta_msg.volume_id);
+            if(vkv == state.volumes.end()){
+                continue;
+            }
+            auto par_it = vkv->second->find(delta_msg.particle_id);
+            if(par_it == vkv->second->end()){
+                continue;
+            }
+            const auto& par = par_it->second;
+            REAL j2 = 0;
+            for(size_t i = 0; i<DIMS; i++){
+                const REAL j = par.mass*(delta_msg.dv[i]+delta_msg.deferred_dv[i]);
+                j2 += j*j;
+            }
+            //a delta that only flushes a deferred dv did not hit anything
+            if(j2 > REAL{0}){
+                auto& window = state.windows[delta_msg.volume_id];
+                window.collisions++;
+                window.virial += par.radius*std::sqrt(j2);
+            }
+        }
+    }
+
+    void confluence_transition(TIME, typename cadmium::make_message_bags<input_ports>::type mbs) {
+        internal_transition();
+        external_transition(TIME{}, std::move(mbs));
+    }
+
+
+    TIME time_advance() const {
+        if(state.pending_observables.size()){
+            return {0};
+        }else{
+            return std::max(state.next_sample-state.global_time, {0});
+        }
+    }
+
+
+    friend std::ostream& operator<<(std::ostream& os, const observer_model& obs) {
+        return os << obs.state;
+    }
+
+
+};
+
+
+
+}
+#endif /* __OBSERVER_MODEL_HPP__ */
@@ -36,6 +36,20 @@ particle<TIME, REAL, DIMS> apply_dv(particle<TIME, REAL, DIMS> par){
     return par;
 }
 
+/*
+    a particle that is not moving and has nothing waiting to change that, it can not leave its volume or hit anything on its own
+    only a delta, from something else hitting it, can wake it up
+*/
+template<typename TIME, typename REAL, std::size_t DIMS>
+bool is_resting(const particle<TIME, REAL, DIMS>& par){
+    for(size_t i=0; i<DIMS; i++){
+        if(par.velocity[i] != REAL{0}){
+            return false;
+        }
+    }
+    return par.deferred_dv_time == std::numeric_limits<TIME>::infinity();
+}
+
 template<typename TIME, typename REAL, std::size_t DIMS>
 particle<TIME, REAL, DIMS> advance_to_time(particle<TIME, REAL, DIMS> par, TIME t){
     auto dt = t - par.last_updated;
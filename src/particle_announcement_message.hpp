@@ -4,22 +4,36 @@
 #include <array>
 #include <vector>
 #include <map>
+#include <set>
 #include <ostream>
 
 #include "./particle.hpp"
+#include "./log_filter.hpp"
 
 namespace tps{
 
 template<typename TIME, typename REAL, std::size_t DIMS>
 struct particle_announcement_message{
     std::array<long, DIMS> volume_id;
-    std::vector<size_t> particle_changed;
-    std::vector<size_t> particle_removed;
+    //these point into the announcing model's double buffered lists, see double_buffer, so announcing never copies them
+    //they are good through every receiver's transition in the step they went out in, but like volume_update, not to be kept past it
+    const std::vector<size_t>* particle_changed;
+    const std::vector<size_t>* particle_removed;
     const std::map<std::size_t, particle<TIME, REAL, DIMS>>* volume_update;
+    //the ids in volume_update that are not resting, or nullptr if the sender does not keep track, and every particle should be treated as moving
+    const std::set<std::size_t>* awake_particles{nullptr};
+    //the ids in volume_update that no other process can see yet, or nullptr if there are none, see rank_bridge_model
+    const std::set<std::size_t>* held_particles{nullptr};
 };
 
 template<typename TIME, typename REAL, std::size_t DIMS>
 std::ostream& operator<<(std::ostream& os, const particle_announcement_message<TIME, REAL, DIMS>& msg) {
+    const auto& view = current_log_view();
+    const auto& filter = view.rules();
+    if(!view.open || !filter.announcements || !filter.volume(msg.volume_id)){
+        return os;
+    }
+
     os << "[[";
 
     for(size_t i = 0; i<DIMS; i++){
@@ -31,20 +45,29 @@ std::ostream& operator<<(std::ostream& os, const particle_announcement_message<T
 
     os << "], [";
 
-    for(size_t i = 0; i<msg.particle_changed.size(); i++){
-        if(i){
-            os << ", ";
+    bool first = true;
+    for(const auto id : *msg.particle_changed){
+        const auto& par = msg.volume_update->at(id);
+        if(filter.particle(par.id, par.species)){
+            if(!first){
+                os << ", ";
+            }
+            first = false;
+            os << par;
         }
-        os << msg.volume_update->at(msg.particle_changed[i]);
     }
 
     os << "], [";
 
-    for(size_t i = 0; i<msg.particle_removed.size(); i++){
-        if(i){
-            os << ", ";
+    first = true;
+    for(const auto id : *msg.particle_removed){
+        if(filter.particle_id(id)){
+            if(!first){
+                os << ", ";
+            }
+            first = false;
+            os << id;
         }
-        os << msg.particle_removed[i];
     }
 
     return os << "]]";
@@ -6,6 +6,7 @@
 #include <limits>
 
 #include "./particle.hpp"
+#include "./log_filter.hpp"
 
 namespace tps{
 
@@ -26,13 +27,20 @@ particle<TIME, REAL, DIMS> apply_delta(particle<TIME, REAL, DIMS> par, particle_
         par.velocity[i] += delta_msg.dv[i];
         par.deferred_dv[i] += delta_msg.deferred_dv[i];
     }
-    par.hits_since_last_deferred_dv_clear += (par.deferred_dv_time <= delta_msg.deferred_dv_time);
+    //only a delta that brings a deferred dv of its own counts as a hit, a plain kick does not
+    par.hits_since_last_deferred_dv_clear += (delta_msg.deferred_dv_time != std::numeric_limits<TIME>::infinity() && par.deferred_dv_time <= delta_msg.deferred_dv_time);
     par.deferred_dv_time = std::min(par.deferred_dv_time, delta_msg.deferred_dv_time);
     return par;
 }
 
 template<typename TIME, typename REAL, std::size_t DIMS>
 std::ostream& operator<<(std::ostream& os, const particle_delta_message<TIME, REAL, DIMS>& msg) {
+    const auto& view = current_log_view();
+    const auto& filter = view.rules();
+    if(!view.open || !filter.deltas || !filter.volume(msg.volume_id) || !filter.particle_id(msg.particle_id)){
+        return os;
+    }
+
     os << "[[";
 
     for(size_t i = 0; i<DIMS; i++){
@@ -2,21 +2,58 @@
 #define __PARTICLE_MOVING_MESSAGE_HPP__
 
 #include <array>
+#include <vector>
 #include <ostream>
 #include <map>
 #include <limits>
 #include <cmath>
 
 #include "./particle.hpp"
+#include "./small_vector.hpp"
+#include "./log_filter.hpp"
 
 namespace tps{
 
+/*
+    A block of particles that are all moving into the same volume.
+    A volume sends at most one message per neighbour per transition, however many particles go the same way,
+    and the receiver only has to check destination_id once per block rather than once per particle.
+    That check is still made by every face neighbour, not just the destination. A volume has the one particle_leaving port,
+    and make_sharded_grid couples it to every face neighbour's particle_entering, so each of them is handed each block
+    and drops the ones for other volumes. Batching cuts the number of messages, not how many volumes get each one.
+    Only the sparse grid hands a block to its destination alone, see sparse_grid_model::deliver.
+    Most blocks are one particle, so room for two is kept in the message itself, and only bigger blocks touch the heap.
+*/
 template<typename TIME, typename REAL, std::size_t DIMS>
 struct particle_moving_message{
+    static constexpr std::size_t inline_size = 2;
+
     std::array<long, DIMS> destination_id;
-    particle<TIME, REAL, DIMS> moving_particle;
+    small_vector<particle<TIME, REAL, DIMS>, inline_size> moving_particles;
+
+    std::size_t size() const { return moving_particles.size(); }
+    particle<TIME, REAL, DIMS>* begin(){ return moving_particles.begin(); }
+    particle<TIME, REAL, DIMS>* end(){ return moving_particles.end(); }
+    const particle<TIME, REAL, DIMS>* begin() const { return moving_particles.begin(); }
+    const particle<TIME, REAL, DIMS>* end() const { return moving_particles.end(); }
 };
 
+/*
+    add par to the block in pending that is going to destination_id, or start a new block if there is none yet
+*/
+template<typename TIME, typename REAL, std::size_t DIMS>
+void add_to_moving_block(std::vector<particle_moving_message<TIME, REAL, DIMS>>& pending, const std::array<long, DIMS>& destination_id, const particle<TIME, REAL, DIMS>& par){
+    for(auto& block : pending){
+        if(block.destination_id == destination_id){
+            block.moving_particles.push_back(par);
+            return;
+        }
+    }
+    pending.emplace_back();
+    pending.back().destination_id = destination_id;
+    pending.back().moving_particles.push_back(par);
+}
+
 template<typename TIME, std::size_t DIMS>
 struct time_and_direction{
     TIME moving_time;
@@ -82,6 +119,12 @@ TIME move_out_time(particle<TIME, REAL, DIMS> par, std::array<REAL, DIMS> corner
 
 template<typename TIME, typename REAL, std::size_t DIMS>
 std::ostream& operator<<(std::ostream& os, const particle_moving_message<TIME, REAL, DIMS>& msg) {
+    const auto& view = current_log_view();
+    const auto& filter = view.rules();
+    if(!view.open || !filter.moves || !filter.volume(msg.destination_id)){
+        return os;
+    }
+
     os << "[[";
 
     for(size_t i = 0; i<DIMS; i++){
@@ -91,7 +134,20 @@ std::ostream& operator<<(std::ostream& os, const particle_moving_message<TIME, R
         os << msg.destination_id[i];
     }
 
-    return os << "], " << msg.moving_particle << "]";
+    os << "], [";
+
+    bool first = true;
+    for(const auto& par : msg){
+        if(filter.particle(par.id, par.species)){
+            if(!first){
+                os << ", ";
+            }
+            first = false;
+            os << par;
+        }
+    }
+
+    return os << "]]";
 }
 
 }
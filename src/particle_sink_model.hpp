@@ -0,0 +1,118 @@
+#ifndef __PARTICLE_SINK_MODEL_HPP__
+#define __PARTICLE_SINK_MODEL_HPP__
+
+
+#include <cadmium/modeling/ports.hpp>
+#include <cadmium/modeling/message_bag.hpp>
+
+#include <set>
+#include <array>
+#include <limits>
+
+#include "./particle.hpp"
+#include "./particle_moving_message.hpp"
+
+namespace tps{
+
+template<typename TIME, typename REAL, std::size_t DIMS>
+struct sink_defs{
+
+    struct particle_leaving         : public cadmium::in_port<particle_moving_message<TIME, REAL, DIMS>> {};
+
+};
+
+/*
+    Soaks up the particles that volumes on the edge of a grid send off into volumes that do not exist.
+    Without a sink those particles are still gone, the leaving volume drops them and nothing picks them up, this just counts what went out and how.
+    It never has anything to do on its own, and never sends anything.
+*/
+template<typename TIME, typename REAL, std::size_t DIMS>
+struct particle_sink_model{
+    struct settings_type{
+        //the volume ids, outside of the grid, that count as this outlet, empty takes everything it hears
+        std::set<std::array<long, DIMS>> outlets{};
+    };
+    settings_type settings;
+
+    struct state_type{
+        TIME global_time{0};
+
+        std::size_t absorbed{0};
+        REAL mass{0};
+        std::array<REAL, DIMS> momentum{};
+        REAL energy{0};
+        TIME last_absorbed{-std::numeric_limits<TIME>::infinity()};
+
+        friend std::ostream& operator<<(std::ostream& os, const state_type& state) {
+            os << "{\"absorbed\":" << state.absorbed << ", \"mass\":" << state.mass << ", \"momentum\":[";
+            for(size_t i = 0; i<DIMS; i++){
+                if(i){
+                    os << ", ";
+                }
+                os << state.momentum[i];
+            }
+            return os << "], \"energy\":" << state.energy << "}";
+        }
+    };
+    state_type state;
+
+    using input_ports = std::tuple<
+        typename sink_defs<TIME, REAL, DIMS>::particle_leaving
+    >;
+
+    using output_ports = std::tuple<>;
+
+    particle_sink_model<TIME, REAL, DIMS>(){};
+    particle_sink_model<TIME, REAL, DIMS>(settings_type settings) : settings(std::move(settings)) {};
+
+    typename cadmium::make_message_bags<output_ports>::type output() const {
+        return {};
+    }
+
+    void internal_transition(){
+    }
+
+    void external_transition(TIME dt, typename cadmium::make_message_bags<input_ports>::type mbs) {
+        state.global_time += dt;
+        for(const auto& move_msg : cadmium::get_messages<typename sink_defs<TIME, REAL, DIMS>::particle_leaving>(mbs)){
+            if(settings.outlets.size() && !settings.outlets.count(move_msg.destination_id)){
+                continue;
+            }
+            for(const auto& par : move_msg){
+                //a deferred dv that has not landed yet still belongs to the particle
+                REAL v2 = 0;
+                for(size_t i = 0; i<DIMS; i++){
+                    const REAL v = par.velocity[i]+(par.deferred_dv_time != std::numeric_limits<TIME>::infinity() ? par.deferred_dv[i] : REAL{0});
+                    state.momentum[i] += par.mass*v;
+                    v2 += v*v;
+                }
+                state.absorbed++;
+                state.mass += par.mass;
+                state.energy += par.mass*v2/2;
+                state.last_absorbed = state.global_time;
+            }
+        }
+    }
+
+    void confluence_transition(TIME, typename cadmium::make_message_bags<input_ports>::type mbs) {
+        internal_transition();
+        external_transition(TIME{}, std::move(mbs));
+    }
+
+
+    TIME time_advance() const {
+        return std::numeric_limits<TIME>::infinity();
+    }
+
+
+    friend std::ostream& operator<<(std::ostream& os, const particle_sink_model& sink) {
+        return os << sink.state;
+    }
+
+
+};
+
+
+
+}
+#endif /* __PARTICLE_SINK_MODEL_HPP__ */
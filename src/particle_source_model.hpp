@@ -0,0 +1,201 @@
+#ifndef __PARTICLE_SOURCE_MODEL_HPP__
+#define __PARTICLE_SOURCE_MODEL_HPP__
+
+
+#include <cadmium/modeling/ports.hpp>
+#include <cadmium/modeling/message_bag.hpp>
+
+#include <map>
+#include <vector>
+#include <cmath>
+#include <limits>
+#include <random>
+#include <algorithm>
+
+#include "./particle.hpp"
+#include "./particle_moving_message.hpp"
+#include "./particle_announcement_message.hpp"
+
+namespace tps{
+
+template<typename TIME, typename REAL, std::size_t DIMS>
+struct source_defs{
+
+    struct particle_announcement    : public cadmium::in_port<particle_announcement_message<TIME, REAL, DIMS>> {};
+
+    struct particle_created         : public cadmium::out_port<particle_moving_message<TIME, REAL, DIMS>> {};
+
+};
+
+/*
+    Makes new particles and hands them to one volume, as if they had come in from a neighbour.
+    Every interval it picks a spot in its box and a velocity from a normal distribution per axis.
+    If the new particle would overlap one already in the volume it is not made, and the source tries again next interval.
+
+    Ids are first_id, first_id+id_stride, first_id+2*id_stride, ...
+    Give each source its own first_id below id_stride, and keep the particles that are there from the start below first_id,
+    then no two particles in a run can ever share an id.
+*/
+template<typename TIME, typename REAL, std::size_t DIMS>
+struct particle_source_model{
+    struct settings_type{
+        std::array<long, DIMS> volume_id{};
+        //the box new particles are placed in, it should be inside volume_id
+        std::array<REAL, DIMS> corner{};
+        std::array<REAL, DIMS> size{};
+
+        std::array<REAL, DIMS> velocity_mean{};
+        std::array<REAL, DIMS> velocity_sigma{};
+        std::size_t species{0};
+        REAL mass{1};
+        REAL radius{1};
+
+        TIME start{0};
+        TIME interval{1};
+        //exponential gaps with a mean of interval, instead of exactly interval
+        bool poisson{false};
+        //stop after making this many
+        std::size_t limit{std::numeric_limits<std::size_t>::max()};
+
+        std::size_t first_id{0};
+        std::size_t id_stride{1};
+        unsigned seed{0};
+    };
+    settings_type settings;
+
+    struct state_type{
+        TIME global_time{0};
+        TIME next_time{0};
+        std::vector<particle_moving_message<TIME, REAL, DIMS>> pending_created{};
+
+        //the live particle map of the volume we feed, from its last announcement
+        const std::map<std::size_t, particle<TIME, REAL, DIMS>>* volume{nullptr};
+
+        std::mt19937 random{};
+        std::size_t made{0};
+        std::size_t blocked{0};
+
+        friend std::ostream& operator<<(std::ostream& os, const state_type& state) {
+            return os << "{\"made\":" << state.made << ", \"blocked\":" << state.blocked << "}";
+        }
+    };
+    state_type state;
+
+    using input_ports = std::tuple<
+        typename source_defs<TIME, REAL, DIMS>::particle_announcement
+    >;
+
+    using output_ports = std::tuple<
+        typename source_defs<TIME, REAL, DIMS>::particle_created
+    >;
+
+    particle_source_model<TIME, REAL, DIMS>(){};
+    particle_source_model<TIME, REAL, DIMS>(settings_type settings) : settings(std::move(settings)) {
+        state.random.seed(this->settings.seed);
+        state.next_time = this->settings.limit ? this->settings.start : std::numeric_limits<TIME>::infinity();
+    };
+
+    TIME gap(){
+        if(settings.poisson){
+            return std::exponential_distribution<TIME>(1/settings.interval)(state.random);
+        }
+        return settings.interval;
+    }
+
+    bool overlaps(const particle<TIME, REAL, DIMS>& par) const {
+        if(!state.volume){
+            return false;
+        }
+        for(const auto& kv : *state.volume){
+            const auto other = advance_to_time(kv.second, state.global_time);
+            REAL d2 = 0;
+            for(size_t i = 0; i<DIMS; i++){
+                d2 += (other.position[i]-par.position[i])*(other.position[i]-par.position[i]);
+            }
+            if(d2 < (other.radius+par.radius)*(other.radius+par.radius)){
+                return true;
+            }
+        }
+        return false;
+    }
+
+    typename cadmium::make_message_bags<output_ports>::type output() const {
+        typename cadmium::make_message_bags<output_ports>::type bag;
+
+        auto& created = cadmium::get_messages<typename source_defs<TIME, REAL, DIMS>::particle_created>(bag);
+        created.insert(created.end(), state.pending_created.begin(), state.pending_created.end());
+
+        return bag;
+    }
+
+    void internal_transition(){
+        state.global_time += time_advance();
+
+        //We just got here from the output function, we can clear what it sent
+        if(state.pending_created.size()){
+            state.pending_created.clear();
+            return;
+        }
+
+        particle<TIME, REAL, DIMS> par{};
+        par.last_updated = state.global_time;
+        par.id = settings.first_id+state.made*settings.id_stride;
+        par.species = settings.species;
+        par.mass = settings.mass;
+        par.radius = settings.radius;
+        for(size_t i = 0; i<DIMS; i++){
+            par.position[i] = settings.corner[i]+std::uniform_real_distribution<REAL>(0, 1)(state.random)*settings.size[i];
+            par.velocity[i] = settings.velocity_mean[i];
+            if(settings.velocity_sigma[i] > REAL{0}){
+                par.velocity[i] += std::normal_distribution<REAL>(0, settings.velocity_sigma[i])(state.random);
+            }
+        }
+        par.deferred_dv = {};
+        par.deferred_dv_time = std::numeric_limits<TIME>::infinity();
+        par.hits_since_last_deferred_dv_clear = 0;
+
+        if(overlaps(par)){
+            state.blocked++;
+        }else{
+            add_to_moving_block(state.pending_created, settings.volume_id, par);
+            state.made++;
+        }
+        state.next_time = state.made < settings.limit ? state.global_time+gap() : std::numeric_limits<TIME>::infinity();
+    }
+
+    void external_transition(TIME dt, typename cadmium::make_message_bags<input_ports>::type mbs) {
+        state.global_time += dt;
+        for(const auto& msg : cadmium::get_messages<typename source_defs<TIME, REAL, DIMS>::particle_announcement>(mbs)){
+            if(msg.volume_id == settings.volume_id){
+                //an empty volume may be dropped by a sparse grid, and has nothing to overlap anyway
+                state.volume = msg.volume_update->empty() ? nullptr : msg.volume_update;
+            }
+        }
+    }
+
+    void confluence_transition(TIME, typename cadmium::make_message_bags<input_ports>::type mbs) {
+        internal_transition();
+        external_transition(TIME{}, std::move(mbs));
+    }
+
+
+    TIME time_advance() const {
+        if(state.pending_created.size()){
+            return {0};
+        }else{
+            return std::max(state.next_time-state.global_time, {0});
+        }
+    }
+
+
+    friend std::ostream& operator<<(std::ostream& os, const particle_source_model& src) {
+        return os << src.state;
+    }
+
+
+};
+
+
+
+}
+#endif /* __PARTICLE_SOURCE_MODEL_HPP__ */
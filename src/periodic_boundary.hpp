@@ -0,0 +1,93 @@
+#ifndef __PERIODIC_BOUNDARY_HPP__
+#define __PERIODIC_BOUNDARY_HPP__
+
+#include <array>
+#include <cstddef>
+#include <cmath>
+#include <algorithm>
+
+#include "./particle.hpp"
+
+namespace tps{
+
+/*
+    Which axes wrap around, and how.
+    On an axis with grid[i] > 0 the volume ids run from 0 to grid[i]-1 and wrap, and the grid is length[i] long,
+    so a particle leaving the last volume comes back in the first one, length[i] further down.
+    grid[i] == 0 leaves the axis alone.
+*/
+template<typename REAL, std::size_t DIMS>
+struct periodic_extent{
+    std::array<long, DIMS> grid{};
+    std::array<REAL, DIMS> length{};
+
+    bool any() const {
+        for(size_t i = 0; i<DIMS; i++){
+            if(grid[i]){
+                return true;
+            }
+        }
+        return false;
+    }
+};
+
+template<typename REAL, std::size_t DIMS>
+std::array<long, DIMS> wrap_id(const periodic_extent<REAL, DIMS>& periodic, std::array<long, DIMS> volume_id){
+    for(size_t i = 0; i<DIMS; i++){
+        if(periodic.grid[i]){
+            volume_id[i] = ((volume_id[i]%periodic.grid[i])+periodic.grid[i])%periodic.grid[i];
+        }
+    }
+    return volume_id;
+}
+
+/*
+    a particle is moving to destination_id, if that is off the end of a periodic axis, wrap the id and move the particle to the other side
+*/
+template<typename TIME, typename REAL, std::size_t DIMS>
+void wrap_crossing(const periodic_extent<REAL, DIMS>& periodic, particle<TIME, REAL, DIMS>& par, std::array<long, DIMS>& destination_id){
+    for(size_t i = 0; i<DIMS; i++){
+        if(periodic.grid[i]){
+            if(destination_id[i] >= periodic.grid[i]){
+                destination_id[i] -= periodic.grid[i];
+                par.position[i] -= periodic.length[i];
+            }else if(destination_id[i] < 0){
+                destination_id[i] += periodic.grid[i];
+                par.position[i] += periodic.length[i];
+            }
+        }
+    }
+}
+
+/*
+    the copy of par that is wraps[i] domain lengths further along each axis
+*/
+template<typename TIME, typename REAL, std::size_t DIMS>
+particle<TIME, REAL, DIMS> periodic_image(const periodic_extent<REAL, DIMS>& periodic, particle<TIME, REAL, DIMS> par, const std::array<long, DIMS>& wraps){
+    for(size_t i = 0; i<DIMS; i++){
+        par.position[i] += wraps[i]*periodic.length[i];
+    }
+    return par;
+}
+
+/*
+    rhs moved by whole domain lengths so it is as close to lhs as it can be at time t, the copy of rhs that lhs would actually hit
+    this is only safe for particles that are touching at t, anything further apart should use the image its volume is a neighbour through
+*/
+template<typename TIME, typename REAL, std::size_t DIMS>
+particle<TIME, REAL, DIMS> minimum_image(const periodic_extent<REAL, DIMS>& periodic, const particle<TIME, REAL, DIMS>& lhs, particle<TIME, REAL, DIMS> rhs, TIME t){
+    if(!periodic.any()){
+        return rhs;
+    }
+    const auto l = advance_to_time(lhs, t);
+    const auto r = advance_to_time(rhs, t);
+    for(size_t i = 0; i<DIMS; i++){
+        if(periodic.grid[i]){
+            rhs.position[i] += periodic.length[i]*std::round((l.position[i]-r.position[i])/periodic.length[i]);
+        }
+    }
+    return rhs;
+}
+
+}
+#endif /* __PERIODIC_BOUNDARY_HPP__ */
@@ -0,0 +1,374 @@
+#ifndef __RANK_BRIDGE_MODEL_HPP__
+#define __RANK_BRIDGE_MODEL_HPP__
+
+
+#include <cadmium/modeling/ports.hpp>
+#include <cadmium/modeling/message_bag.hpp>
+
+#include <map>
+#include <set>
+#include <vector>
+#include <memory>
+#include <limits>
+#include <algorithm>
+#include <stdexcept>
+
+#include "./particle.hpp"
+#include "./particle_moving_message.hpp"
+#include "./particle_delta_message.hpp"
+#include "./particle_announcement_message.hpp"
+#include "./double_buffer.hpp"
+#include "./volume_neighbours.hpp"
+#include "./wire_format.hpp"
+#include "./transport.hpp"
+
+namespace tps{
+
+template<typename TIME, typename REAL, std::size_t DIMS>
+struct rank_bridge_defs{
+
+    struct particle_leaving         : public cadmium::in_port<particle_moving_message<TIME, REAL, DIMS>> {};
+    struct particle_announcement    : public cadmium::in_port<particle_announcement_message<TIME, REAL, DIMS>> {};
+    struct particle_delta           : public cadmium::in_port<particle_delta_message<TIME, REAL, DIMS>> {};
+
+    struct particle_entering        : public cadmium::out_port<particle_moving_message<TIME, REAL, DIMS>> {};
+    struct ghost_announcement       : public cadmium::out_port<particle_announcement_message<TIME, REAL, DIMS>> {};
+    struct remote_delta             : public cadmium::out_port<particle_delta_message<TIME, REAL, DIMS>> {};
+
+};
+
+/*
+    Stands in for every volume that lives in another process.
+    It listens to the local volumes on the edge of this rank, and to the local colliders, the same way a neighbouring volume or collider would,
+    and passes on anything meant for a remote volume. Remote volumes on the edge are mirrored here as ghost volumes and announced to the local colliders,
+    so those colliders can check local particles against remote ones as halo volumes.
+
+    Ranks run in lock step: every sync_interval of simulated time, each rank swaps everything it has queued with each peer.
+    Anything that crosses a rank boundary is late by up to sync_interval. Moved particles carry their own last_updated, so their paths are still exact,
+    but collisions across the boundary are seen and answered up to sync_interval late. Keep it small next to how long a particle takes to cross a volume.
+    Deltas that local colliders send to remote particles are also applied to the ghosts here, so the ghosts are never behind on what this rank did to them.
+
+    A particle sent to a peer is not in any of the peer's volumes until the next sync. It is put in the ghost of the volume it is going to straight away,
+    so the local colliders keep hitting it in the meantime, and it stays there until the peer's own copy of that volume comes back, one sync after it was handed over.
+    It is only written out at the sync, as the ghost is by then, so what the local colliders did to it on the way gets there exact, not as late deltas.
+    The peer's particles do not see it until it gets there, a hit between the two in that window is still missed.
+*/
+template<typename TIME, typename REAL, std::size_t DIMS>
+struct rank_bridge_model{
+
+    struct peer_type{
+        std::shared_ptr<transport> link{};
+        //the volumes that live on that peer, anything addressed to one of these goes over link
+        std::set<std::array<long, DIMS>> volumes{};
+    };
+
+    struct settings_type{
+        TIME sync_interval{1};
+        //exchanges happen with peers in this order, so every rank must list its peers in the same global order (lowest rank first)
+        std::vector<peer_type> peers{};
+    };
+    settings_type settings;
+
+    struct ghost_volume{
+        std::map<std::size_t, particle<TIME, REAL, DIMS>> particles{};
+        //flipped like a volume's pending lists, so the ghost announcements can point at them
+        double_buffer<std::vector<size_t>> changed{};
+        double_buffer<std::vector<size_t>> removed{};
+        //the particles on their way to this volume from here that have not been sent yet, only the local colliders can hit them until then
+        std::set<std::size_t> held{};
+    };
+
+    struct state_type{
+        TIME global_time{0};
+        TIME next_sync{0};
+
+        /* what is waiting to go to each peer, and what every local edge volume looked like the last time it was sent */
+        std::vector<std::vector<char>> outboxes{};
+        std::map<std::array<long, DIMS>, std::map<std::size_t, particle<TIME, REAL, DIMS>>> sent_volumes{};
+        std::set<std::array<long, DIMS>> dirty_volumes{};
+        //the live particle map of each local edge volume, from its last announcement
+        std::map<std::array<long, DIMS>, const std::map<std::size_t, particle<TIME, REAL, DIMS>>*> local_volumes{};
+        std::vector<char> inbox{};
+
+        /* what came back from the peers, waiting to be output */
+        std::map<std::array<long, DIMS>, ghost_volume> ghosts{};
+        //particles sent to a peer that are only ghosts here until the peer says where they are, with the ghost volume they went into and the sync they were sent before
+        std::map<std::size_t, std::pair<std::array<long, DIMS>, std::size_t>> in_transit{};
+        std::vector<particle_moving_message<TIME, REAL, DIMS>> leaving{};
+        std::vector<std::array<long, DIMS>> pending_ghosts{};
+        std::vector<particle_moving_message<TIME, REAL, DIMS>> pending_entering{};
+        std::vector<particle_delta_message<TIME, REAL, DIMS>> pending_deltas{};
+
+        std::size_t syncs{0};
+        std::size_t bytes_sent{0};
+        std::size_t bytes_received{0};
+
+        friend std::ostream& operator<<(std::ostream& os, const state_type& state) {
+            return os << "{\"syncs\":" << state.syncs << ", \"sent\":" << state.bytes_sent << ", \"received\":" << state.bytes_received << "}";
+        }
+    };
+    state_type state;
+
+    using input_ports = std::tuple<
+        typename rank_bridge_defs<TIME, REAL, DIMS>::particle_leaving,
+        typename rank_bridge_defs<TIME, REAL, DIMS>::particle_announcement,
+        typename rank_bridge_defs<TIME, REAL, DIMS>::particle_delta
+    >;
+
+    using output_ports = std::tuple<
+        typename rank_bridge_defs<TIME, REAL, DIMS>::particle_entering,
+        typename rank_bridge_defs<TIME, REAL, DIMS>::ghost_announcement,
+        typename rank_bridge_defs<TIME, REAL, DIMS>::remote_delta
+    >;
+
+    rank_bridge_model<TIME, REAL, DIMS>(){};
+    rank_bridge_model<TIME, REAL, DIMS>(settings_type settings) : settings(std::move(settings)) {
+        state.outboxes.resize(this->settings.peers.size());
+        state.next_sync = this->settings.sync_interval;
+    };
+
+    //the index of the peer that holds volume_id, or peers.size() if it is local or unknown
+    std::size_t peer_of(const std::array<long, DIMS>& volume_id) const {
+        for(std::size_t i = 0; i<settings.peers.size(); i++){
+            if(settings.peers[i].volumes.count(volume_id)){
+                return i;
+            }
+        }
+        return settings.peers.size();
+    }
+
+    //the ghost volume is announced with the next output, whatever else changes in it before then
+    void announce_ghost(const std::array<long, DIMS>& volume_id){
+        if(std::find(state.pending_ghosts.begin(), state.pending_ghosts.end(), volume_id) == state.pending_ghosts.end()){
+            state.pending_ghosts.push_back(volume_id);
+        }
+    }
+
+    void drop_ghost(const std::array<long, DIMS>& volume_id, std::size_t id){
+        auto& ghost = state.ghosts.at(volume_id);
+        ghost.particles.erase(id);
+        ghost.held.erase(id);
+        ghost.removed->push_back(id);
+        announce_ghost(volume_id);
+    }
+
+    typename cadmium::make_message_bags<output_ports>::type output() const {
+        typename cadmium::make_message_bags<output_ports>::type bag;
+
+        auto& entering = cadmium::get_messages<typename rank_bridge_defs<TIME, REAL, DIMS>::particle_entering>(bag);
+        entering.insert(entering.end(), state.pending_entering.begin(), state.pending_entering.end());
+
+        for(const auto& volume_id : state.pending_ghosts){
+            const auto& ghost = state.ghosts.at(volume_id);
+            cadmium::get_messages<typename rank_bridge_defs<TIME, REAL, DIMS>::ghost_announcement>(bag).push_back({volume_id, &*ghost.changed, &*ghost.removed, &ghost.particles, nullptr, &ghost.held});
+        }
+
+        auto& deltas = cadmium::get_messages<typename rank_bridge_defs<TIME, REAL, DIMS>::remote_delta>(bag);
+        deltas.insert(deltas.end(), state.pending_deltas.begin(), state.pending_deltas.end());
+
+        return bag;
+    }
+
+    /*
+        Whether what a peer just said about particle id in volume_id is to be taken.
+        Not if the particle was sent to the peer since the last sync, the peer has not got it yet so what it says is older than the ghost.
+        Otherwise the peer now has it wherever it says, so it is taken out of the ghost it was put in when it was sent, if that is another one.
+    */
+    bool settle_transit(const std::array<long, DIMS>& volume_id, std::size_t id){
+        auto it = state.in_transit.find(id);
+        if(it == state.in_transit.end()){
+            return true;
+        }
+        if(it->second.second == state.syncs){
+            return false;
+        }
+        if(it->second.first != volume_id){
+            drop_ghost(it->second.first, id);
+        }
+        state.in_transit.erase(it);
+        return true;
+    }
+
+    void sync(){
+        //what left for a peer since the last sync goes as its ghost is now, from here on the peer's colliders see it too
+        for(const auto& tkv : state.in_transit){
+            if(tkv.second.second == state.syncs){
+                auto& ghost = state.ghosts.at(tkv.second.first);
+                add_to_moving_block(state.leaving, tkv.second.first, ghost.particles.at(tkv.first));
+                ghost.held.erase(tkv.first);
+                announce_ghost(tkv.second.first);
+            }
+        }
+        for(const auto& block : state.leaving){
+            wire_writer out{state.outboxes[peer_of(block.destination_id)]};
+            write_message(out, block);
+        }
+        state.leaving.clear();
+
+        //the local edge volumes are only diffed now, so a volume that changed many times since the last sync only goes out once
+        for(const auto& volume_id : state.dirty_volumes){
+            for(std::size_t i = 0; i<settings.peers.size(); i++){
+                bool near = false;
+                for_each_neighbour(volume_id, [&](const std::array<long, DIMS>& nid){
+                    near |= settings.peers[i].volumes.count(nid) > 0;
+                });
+                if(near){
+                    wire_writer out{state.outboxes[i]};
+                    //diff against a copy, every peer near this volume needs the same update
+                    std::map<std::size_t, particle<TIME, REAL, DIMS>> sent = state.sent_volumes[volume_id];
+                    write_volume_update(out, volume_id, *state.local_volumes.at(volume_id), sent);
+                }
+            }
+            state.sent_volumes[volume_id] = *state.local_volumes.at(volume_id);
+        }
+        state.dirty_volumes.clear();
+
+        for(std::size_t i = 0; i<settings.peers.size(); i++){
+            settings.peers[i].link->exchange(state.outboxes[i], state.inbox);
+            state.bytes_sent += state.outboxes[i].size();
+            state.bytes_received += state.inbox.size();
+            state.outboxes[i].clear();
+
+            wire_reader in{state.inbox};
+            while(!in.done()){
+                switch(in.get<wire_record>()){
+                    case wire_record::moving:
+                        state.pending_entering.push_back(read_moving_message<TIME, REAL, DIMS>(in));
+                        break;
+                    case wire_record::delta:
+                        state.pending_deltas.push_back(read_delta_message<TIME, REAL, DIMS>(in));
+                        break;
+                    case wire_record::volume:{
+                        const auto volume_id = in.get<std::array<long, DIMS>>();
+                        auto& ghost = state.ghosts[volume_id];
+                        announce_ghost(volume_id);
+                        const auto changed = in.get<std::size_t>();
+                        for(std::size_t j = 0; j<changed; j++){
+                            const auto par = read_particle<TIME, REAL, DIMS>(in);
+                            if(!settle_transit(volume_id, par.id)){
+                                continue;
+                            }
+                            ghost.particles[par.id] = par;
+                            ghost.changed->push_back(par.id);
+                        }
+                        const auto removed = in.get<std::size_t>();
+                        for(std::size_t j = 0; j<removed; j++){
+                            const auto id = in.get<std::size_t>();
+                            if(!settle_transit(volume_id, id)){
+                                continue;
+                            }
+                            ghost.particles.erase(id);
+                            ghost.removed->push_back(id);
+                        }
+                        break;
+                    }
+                    default:
+                        throw std::runtime_error("unknown record on the wire");
+                }
+            }
+        }
+
+        //a particle handed over at the last sync that the peer did not mention is no longer anywhere near this rank
+        for(auto it = state.in_transit.begin(); it != state.in_transit.end();){
+            if(it->second.second < state.syncs){
+                drop_ghost(it->second.first, it->first);
+                it = state.in_transit.erase(it);
+            }else{
+                it++;
+            }
+        }
+        state.syncs++;
+    }
+
+    void internal_transition(){
+        state.global_time += time_advance();
+
+        //We just got here from the output function, what it sent is left on the other side of each ghost's lists
+        for(const auto& volume_id : state.pending_ghosts){
+            state.ghosts.at(volume_id).changed.flip();
+            state.ghosts.at(volume_id).removed.flip();
+        }
+        state.pending_ghosts.clear();
+        state.pending_entering.clear();
+        state.pending_deltas.clear();
+
+        if(state.global_time >= state.next_sync){
+            sync();
+            state.next_sync += settings.sync_interval;
+        }
+    }
+
+    void external_transition(TIME dt, typename cadmium::make_message_bags<input_ports>::type mbs) {
+        state.global_time += dt;
+
+        for(const auto& move_msg : cadmium::get_messages<typename rank_bridge_defs<TIME, REAL, DIMS>::particle_leaving>(mbs)){
+            const std::size_t i = peer_of(move_msg.destination_id);
+            if(i < settings.peers.size()){
+                //the local colliders keep seeing it until it is in the peer's volume, it is sent from the ghost at the sync
+                auto& ghost = state.ghosts[move_msg.destination_id];
+                for(const auto& par : move_msg){
+                    ghost.particles[par.id] = par;
+                    ghost.held.insert(par.id);
+                    ghost.changed->push_back(par.id);
+                    state.in_transit[par.id] = {move_msg.destination_id, state.syncs};
+                }
+                announce_ghost(move_msg.destination_id);
+            }
+        }
+
+        for(const auto& msg : cadmium::get_messages<typename rank_bridge_defs<TIME, REAL, DIMS>::particle_announcement>(mbs)){
+            //only remember who to diff at the next sync, the map is read then
+            state.local_volumes[msg.volume_id] = msg.volume_update;
+            state.dirty_volumes.insert(msg.volume_id);
+        }
+
+        for(const auto& delta_msg : cadmium::get_messages<typename rank_bridge_defs<TIME, REAL, DIMS>::particle_delta>(mbs)){
+            const std::size_t i = peer_of(delta_msg.volume_id);
+            if(i < settings.peers.size()){
+                //a particle that has not been sent yet takes the delta with it
+                auto transit = state.in_transit.find(delta_msg.particle_id);
+                if(transit == state.in_transit.end() || transit->second.second != state.syncs){
+                    wire_writer out{state.outboxes[i]};
+                    write_message(out, delta_msg);
+                }
+
+                //do to the ghost what the remote volume is going to do to the real particle, so the local colliders do not keep hitting the old one until the next sync
+                auto ghost_it = state.ghosts.find(delta_msg.volume_id);
+                if(ghost_it != state.ghosts.end()){
+                    auto par_it = ghost_it->second.particles.find(delta_msg.particle_id);
+                    if(par_it != ghost_it->second.particles.end()){
+                        par_it->second = apply_delta(advance_to_time(par_it->second, state.global_time), delta_msg);
+                        ghost_it->second.changed->push_back(delta_msg.particle_id);
+                        announce_ghost(delta_msg.volume_id);
+                    }
+                }
+            }
+        }
+    }
+
+    void confluence_transition(TIME, typename cadmium::make_message_bags<input_ports>::type mbs) {
+        internal_transition();
+        external_transition(TIME{}, std::move(mbs));
+    }
+
+
+    TIME time_advance() const {
+        if(state.pending_entering.size() || state.pending_ghosts.size() || state.pending_deltas.size()){
+            return {0};
+        }else{
+            return std::max(state.next_sync-state.global_time, {0});
+        }
+    }
+
+
+    friend std::ostream& operator<<(std::ostream& os, const rank_bridge_model& bridge) {
+        return os << bridge.state;
+    }
+
+
+};
+
+
+
+}
+#endif /* __RANK_BRIDGE_MODEL_HPP__ */
@@ -0,0 +1,154 @@
+#ifndef __SCENARIO_LOADER_HPP__
+#define __SCENARIO_LOADER_HPP__
+
+#include <nlohmann/json.hpp>
+
+#include <array>
+#include <vector>
+#include <string>
+#include <limits>
+#include <fstream>
+#include <stdexcept>
+
+#include "./particle.hpp"
+#include "./grid_topology.hpp"
+
+namespace tps{
+
+/*
+    A run described in json, as written by atps_plan_domain.py
+    The particles use the same layout the particles print in, [last_updated, id, species, mass, radius, [position], [velocity]],
+    optionally followed by [deferred_dv], deferred_dv_time
+    species optionally lists how pairs of species meet, [{"pair":[a, b], "collide":false}, ...], with any of collide, losses, stick_time and extra_push,
+    and species_default the same fields for every pair that is not listed
+    coalesce_tolerance turns on event coalescing in every volume and collider, see coalescing_error for what it costs
+*/
+template<typename TIME, typename REAL, std::size_t DIMS>
+struct scenario{
+    std::array<long, DIMS> grid_size{};
+    std::array<REAL, DIMS> corner{};
+    std::array<REAL, DIMS> volume_size{};
+    std::array<long, DIMS> shard_size{};
+    bool open_edges{true};
+    std::array<bool, DIMS> periodic{};
+    TIME end_time{std::numeric_limits<TIME>::infinity()};
+
+    std::size_t ranks{1};
+    std::vector<long> rank_cuts{};
+    TIME sync_interval{1};
+
+    std::vector<particle<TIME, REAL, DIMS>> particles{};
+    species_table<TIME, REAL> species{};
+    TIME coalesce_tolerance{0};
+
+    //the slab of this scenario that rank builds, lower and upper link it to the ranks on either side
+    rank_partition<TIME> partition(std::size_t rank, std::shared_ptr<transport> lower = {}, std::shared_ptr<transport> upper = {}) const {
+        return {rank, ranks, lower, upper, sync_interval, rank_cuts};
+    }
+
+    //what the scenario asks of make_sharded_grid besides its geometry, for the whole grid unless given a partition
+    grid_settings<TIME, REAL, DIMS> settings(const rank_partition<TIME>& part = {}) const {
+        grid_settings<TIME, REAL, DIMS> grid{};
+        grid.periodic = periodic;
+        grid.partition = part;
+        grid.species = species;
+        grid.coalesce_tolerance = coalesce_tolerance;
+        return grid;
+    }
+
+    //the whole grid in one process
+    grid_topology<TIME, REAL, DIMS> make_grid() const {
+        return make_sharded_grid<TIME, REAL, DIMS>(grid_size, corner, volume_size, shard_size, particles, open_edges, settings());
+    }
+
+    grid_topology<TIME, REAL, DIMS> make_grid(const rank_partition<TIME>& part) const {
+        return make_sharded_grid<TIME, REAL, DIMS>(grid_size, corner, volume_size, shard_size, particles, open_edges, settings(part));
+    }
+};
+
+template<typename TIME, typename REAL, std::size_t DIMS>
+particle<TIME, REAL, DIMS> particle_from_json(const nlohmann::json& j){
+    if(!j.is_array() || j.size() < 7){
+        throw std::runtime_error("a particle needs at least [last_updated, id, species, mass, radius, [position], [velocity]]");
+    }
+    particle<TIME, REAL, DIMS> par{};
+    par.last_updated = j[0].get<TIME>();
+    par.id = j[1].get<std::size_t>();
+    par.species = j[2].get<std::size_t>();
+    par.mass = j[3].get<REAL>();
+    par.radius = j[4].get<REAL>();
+    if(j[5].size() != DIMS || j[6].size() != DIMS){
+        throw std::runtime_error("particle " + std::to_string(par.id) + " does not have " + std::to_string(DIMS) + " dimensions");
+    }
+    par.position = j[5].get<std::array<REAL, DIMS>>();
+    par.velocity = j[6].get<std::array<REAL, DIMS>>();
+    par.deferred_dv = {};
+    par.deferred_dv_time = std::numeric_limits<TIME>::infinity();
+    par.hits_since_last_deferred_dv_clear = 0;
+    if(j.size() >= 9 && !j[8].is_null()){
+        par.deferred_dv = j[7].get<std::array<REAL, DIMS>>();
+        par.deferred_dv_time = j[8].get<TIME>();
+    }
+    return par;
+}
+
+//the fields that are not given are left as they are in rule
+template<typename TIME, typename REAL>
+species_interaction<TIME, REAL> species_interaction_from_json(const nlohmann::json& j, species_interaction<TIME, REAL> rule){
+    rule.collide = j.value("collide", rule.collide);
+    rule.losses = j.value("losses", rule.losses);
+    rule.stick_time = j.value("stick_time", rule.stick_time);
+    rule.extra_push = j.value("extra_push", rule.extra_push);
+    return rule;
+}
+
+template<typename TIME, typename REAL, std::size_t DIMS>
+scenario<TIME, REAL, DIMS> load_scenario(std::istream& is){
+    const nlohmann::json j = nlohmann::json::parse(is);
+    scenario<TIME, REAL, DIMS> sc{};
+
+    if(j.value("dims", DIMS) != DIMS){
+        throw std::runtime_error("scenario is for " + std::to_string(j.at("dims").get<std::size_t>()) + " dimensions, not " + std::to_string(DIMS));
+    }
+
+    sc.grid_size = j.at("grid_size").get<std::array<long, DIMS>>();
+    sc.corner = j.at("corner").get<std::array<REAL, DIMS>>();
+    sc.volume_size = j.at("volume_size").get<std::array<REAL, DIMS>>();
+    //one shard for the whole grid if it is not given
+    sc.shard_size = j.value("shard_size", sc.grid_size);
+    sc.open_edges = j.value("open_edges", true);
+    sc.periodic = j.value("periodic", std::array<bool, DIMS>{});
+    if(j.contains("end_time")){
+        sc.end_time = j.at("end_time").get<TIME>();
+    }
+
+    sc.ranks = j.value("ranks", std::size_t{1});
+    sc.rank_cuts = j.value("rank_cuts", std::vector<long>{});
+    sc.sync_interval = j.value("sync_interval", TIME{1});
+    sc.coalesce_tolerance = j.value("coalesce_tolerance", TIME{0});
+
+    for(const auto& jp : j.at("particles")){
+        sc.particles.push_back(particle_from_json<TIME, REAL, DIMS>(jp));
+    }
+
+    if(j.contains("species_default")){
+        sc.species.fallback = species_interaction_from_json(j.at("species_default"), sc.species.fallback);
+    }
+    for(const auto& js : j.value("species", nlohmann::json::array())){
+        const auto pair = js.at("pair").get<std::array<std::size_t, 2>>();
+        sc.species.set(pair[0], pair[1], species_interaction_from_json(js, sc.species.fallback));
+    }
+    return sc;
+}
+
+template<typename TIME, typename REAL, std::size_t DIMS>
+scenario<TIME, REAL, DIMS> load_scenario(const std::string& path){
+    std::ifstream is(path);
+    if(!is){
+        throw std::runtime_error("could not open scenario " + path);
+    }
+    return load_scenario<TIME, REAL, DIMS>(is);
+}
+
+}
+#endif /* __SCENARIO_LOADER_HPP__ */
@@ -0,0 +1,53 @@
+#ifndef __SMALL_VECTOR_HPP__
+#define __SMALL_VECTOR_HPP__
+
+#include <array>
+#include <vector>
+#include <cstddef>
+
+namespace tps{
+
+/*
+    A vector that keeps its first N elements inside itself, and only goes to the heap once it grows past that.
+    Once it has gone to the heap every element lives there, so the elements are always in one contiguous run.
+    Copying one that never grew past N copies N elements and allocates nothing.
+*/
+template<typename T, std::size_t N>
+class small_vector{
+    std::array<T, N> local{};
+    std::vector<T> spilled{};
+    std::size_t count{0};
+
+public:
+    T* begin(){ return spilled.empty() ? local.data() : spilled.data(); }
+    T* end(){ return begin()+count; }
+    const T* begin() const { return spilled.empty() ? local.data() : spilled.data(); }
+    const T* end() const { return begin()+count; }
+
+    std::size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+
+    T& operator[](std::size_t i){ return begin()[i]; }
+    const T& operator[](std::size_t i) const { return begin()[i]; }
+
+    void push_back(const T& value){
+        if(spilled.empty() && count < N){
+            local[count++] = value;
+            return;
+        }
+        if(spilled.empty()){
+            spilled.reserve(2*N);
+            spilled.assign(local.begin(), local.begin()+count);
+        }
+        spilled.push_back(value);
+        count++;
+    }
+
+    void clear(){
+        spilled.clear();
+        count = 0;
+    }
+};
+
+}
+#endif /* __SMALL_VECTOR_HPP__ */
@@ -0,0 +1,140 @@
+#ifndef __SNAPSHOT_MODEL_HPP__
+#define __SNAPSHOT_MODEL_HPP__
+
+
+#include <cadmium/modeling/ports.hpp>
+#include <cadmium/modeling/message_bag.hpp>
+
+#include <map>
+#include <array>
+#include <vector>
+#include <memory>
+#include <limits>
+
+#include "./particle.hpp"
+#include "./particle_announcement_message.hpp"
+
+namespace tps{
+
+/*
+    Every particle of the run laid out one field per array, so something outside of the run can read them in place.
+    position and velocity hold DIMS values per particle, particle k's are at [k*DIMS, (k+1)*DIMS).
+    take refills the arrays, it may move them if the run has grown, so anything pointing into them has to be pointed again after each take.
+*/
+template<typename TIME, typename REAL, std::size_t DIMS>
+struct particle_snapshot{
+    //the live particle map of each volume, from its last announcement, kept up to date by a snapshot_model
+    std::map<std::array<long, DIMS>, const std::map<std::size_t, particle<TIME, REAL, DIMS>>*> volumes{};
+
+    TIME time{0};
+    std::vector<std::size_t> id{};
+    std::vector<std::size_t> species{};
+    std::vector<REAL> mass{};
+    std::vector<REAL> radius{};
+    std::vector<REAL> position{};
+    std::vector<REAL> velocity{};
+
+    std::size_t size() const {
+        return id.size();
+    }
+
+    //where every particle is at time t, which should be the time the run has got to
+    void take(TIME t){
+        time = t;
+        id.clear();
+        species.clear();
+        mass.clear();
+        radius.clear();
+        position.clear();
+        velocity.clear();
+        for(const auto& vkv : volumes){
+            for(const auto& pkv : *vkv.second){
+                const auto par = advance_to_time(pkv.second, t);
+                id.push_back(par.id);
+                species.push_back(par.species);
+                mass.push_back(par.mass);
+                radius.push_back(par.radius);
+                position.insert(position.end(), par.position.begin(), par.position.end());
+                velocity.insert(velocity.end(), par.velocity.begin(), par.velocity.end());
+            }
+        }
+    }
+};
+
+template<typename TIME, typename REAL, std::size_t DIMS>
+struct snapshot_defs{
+
+    struct particle_announcement    : public cadmium::in_port<particle_announcement_message<TIME, REAL, DIMS>> {};
+
+};
+
+/*
+    Keeps a particle_snapshot pointed at every volume it hears, so the snapshot can be taken between calls to the runner without any logging.
+    It never has anything to do on its own, and never sends anything.
+*/
+template<typename TIME, typename REAL, std::size_t DIMS>
+struct snapshot_model{
+    struct settings_type{
+        std::shared_ptr<particle_snapshot<TIME, REAL, DIMS>> snapshot{};
+    };
+    settings_type settings;
+
+    struct state_type{
+        TIME global_time{0};
+
+        friend std::ostream& operator<<(std::ostream& os, const state_type&) {
+            return os;
+        }
+    };
+    state_type state;
+
+    using input_ports = std::tuple<
+        typename snapshot_defs<TIME, REAL, DIMS>::particle_announcement
+    >;
+
+    using output_ports = std::tuple<>;
+
+    snapshot_model<TIME, REAL, DIMS>(){};
+    snapshot_model<TIME, REAL, DIMS>(settings_type settings) : settings(std::move(settings)) {};
+
+    typename cadmium::make_message_bags<output_ports>::type output() const {
+        return {};
+    }
+
+    void internal_transition(){
+    }
+
+    void external_transition(TIME dt, typename cadmium::make_message_bags<input_ports>::type mbs) {
+        state.global_time += dt;
+        for(const auto& msg : cadmium::get_messages<typename snapshot_defs<TIME, REAL, DIMS>::particle_announcement>(mbs)){
+            //an empty volume may be dropped by a sparse grid, and has nothing to show anyway
+            if(msg.volume_update->empty()){
+                settings.snapshot->volumes.erase(msg.volume_id);
+            }else{
+                settings.snapshot->volumes[msg.volume_id] = msg.volume_update;
+            }
+        }
+    }
+
+    void confluence_transition(TIME, typename cadmium::make_message_bags<input_ports>::type mbs) {
+        internal_transition();
+        external_transition(TIME{}, std::move(mbs));
+    }
+
+
+    TIME time_advance() const {
+        return std::numeric_limits<TIME>::infinity();
+    }
+
+
+    friend std::ostream& operator<<(std::ostream& os, const snapshot_model& snap) {
+        return os << snap.state;
+    }
+
+
+};
+
+
+
+}
+#endif /* __SNAPSHOT_MODEL_HPP__ */
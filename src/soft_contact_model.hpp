@@ -0,0 +1,292 @@
+#ifndef __SOFT_CONTACT_MODEL_HPP__
+#define __SOFT_CONTACT_MODEL_HPP__
+
+
+#include <cadmium/modeling/ports.hpp>
+#include <cadmium/modeling/message_bag.hpp>
+
+#include <map>
+#include <set>
+#include <array>
+#include <vector>
+#include <cmath>
+#include <limits>
+#include <algorithm>
+
+#include "./particle.hpp"
+#include "./particle_delta_message.hpp"
+#include "./particle_announcement_message.hpp"
+#include "./contact_region_message.hpp"
+#include "./species_interactions.hpp"
+#include "./volume_neighbours.hpp"
+
+namespace tps{
+
+template<typename TIME, typename REAL, std::size_t DIMS>
+struct soft_contact_defs{
+
+    struct particle_announcement    : public cadmium::in_port<particle_announcement_message<TIME, REAL, DIMS>> {};
+    //what the blocking colliders send to the volumes, only to count their hits
+    struct collider_delta           : public cadmium::in_port<particle_delta_message<TIME, REAL, DIMS>> {};
+
+    struct particle_delta           : public cadmium::out_port<particle_delta_message<TIME, REAL, DIMS>> {};
+    struct contact_region           : public cadmium::out_port<contact_region_message<DIMS>> {};
+
+};
+
+/*
+    Takes volumes that are in constant contact away from the blocking colliders, and pushes their particles apart with springs on a fixed step instead.
+    A jammed pile costs the blocking colliders a hit, and two events, every time any two of its particles touch, with no bound on how many that is,
+    here it costs one sweep over its pairs each step, however hard they are pressed together.
+
+    It counts the hits the colliders send out, and a volume whose particles have been in handoff_hits of them within one handoff_window is taken over.
+    Every collider is told, and from then on skips every pair with both particles in taken volumes, those pairs are all handled here.
+    A pair with one particle outside of them is still hit by the colliders, so nothing can pass through the edge of a pile between two steps.
+    Each step, every pair that overlaps gets a kick along the line between them, of stiffness*overlap plus damping times how fast they close,
+    held for the whole step, and the particles fly straight from there to the next one, like they always do.
+    A volume that has gone relax_steps steps in a row with none of its particles overlapping anything is given back to the colliders,
+    which work out its hits from scratch. With no overlap left they start from particles that are only touching at most.
+
+    The contact is a spring, so step has to be well under its period, 2*pi*sqrt(m/stiffness) for the lightest particle it pushes on,
+    and stiffness has to be big enough that the heaviest one can not push far into another before it is stopped.
+    Only the volumes of this process are seen, and periodic axes are not wrapped.
+*/
+template<typename TIME, typename REAL, std::size_t DIMS>
+struct soft_contact_model{
+    struct settings_type{
+        //counted per particle, a hit between two particles counts once for each of their volumes
+        std::size_t handoff_hits{50};
+        TIME handoff_window{1};
+
+        TIME step{0.001};
+        REAL stiffness{1e4};
+        REAL damping{10};
+        std::size_t relax_steps{10};
+
+        //pairs that do not collide are never pushed apart, add_soft_contact fills this in with the table the colliders have
+        species_table<TIME, REAL> species{};
+    };
+    settings_type settings;
+
+    struct state_type{
+        TIME global_time{0};
+        std::vector<particle_delta_message<TIME, REAL, DIMS>> pending_deltas{};
+        std::vector<contact_region_message<DIMS>> pending_regions{};
+
+        //the live particle map of each volume, from its last announcement
+        std::map<std::array<long, DIMS>, const std::map<std::size_t, particle<TIME, REAL, DIMS>>*> volumes{};
+        //when each volume's count of hits started, and how many it is up to
+        std::map<std::array<long, DIMS>, std::pair<TIME, std::size_t>> hits{};
+        //the volumes taken over, and how many steps in a row each has gone without an overlap
+        std::map<std::array<long, DIMS>, std::size_t> soft{};
+        TIME next_step{std::numeric_limits<TIME>::infinity()};
+
+        //scratch space for steps, kept here so it does not go back to the heap every step
+        std::map<std::size_t, std::pair<std::array<long, DIMS>, std::array<REAL, DIMS>>> kicks{};
+        std::set<std::array<long, DIMS>> touching{};
+
+        std::size_t steps{0};
+        std::size_t contacts{0};
+        std::size_t taken{0};
+        std::size_t given_back{0};
+
+        friend std::ostream& operator<<(std::ostream& os, const state_type& state) {
+            return os << "{\"steps\":" << state.steps << ", \"contacts\":" << state.contacts << ", \"taken\":" << state.taken << ", \"given_back\":" << state.given_back << ", \"soft\":" << state.soft.size() << "}";
+        }
+    };
+    state_type state;
+
+    using input_ports = std::tuple<
+        typename soft_contact_defs<TIME, REAL, DIMS>::particle_announcement,
+        typename soft_contact_defs<TIME, REAL, DIMS>::collider_delta
+    >;
+
+    using output_ports = std::tuple<
+        typename soft_contact_defs<TIME, REAL, DIMS>::particle_delta,
+        typename soft_contact_defs<TIME, REAL, DIMS>::contact_region
+    >;
+
+    soft_contact_model<TIME, REAL, DIMS>(){};
+    soft_contact_model<TIME, REAL, DIMS>(settings_type settings) : settings(std::move(settings)) {};
+
+    typename cadmium::make_message_bags<output_ports>::type output() const {
+        typename cadmium::make_message_bags<output_ports>::type bag;
+
+        auto& deltas = cadmium::get_messages<typename soft_contact_defs<TIME, REAL, DIMS>::particle_delta>(bag);
+        deltas.insert(deltas.end(), state.pending_deltas.begin(), state.pending_deltas.end());
+        auto& regions = cadmium::get_messages<typename soft_contact_defs<TIME, REAL, DIMS>::contact_region>(bag);
+        regions.insert(regions.end(), state.pending_regions.begin(), state.pending_regions.end());
+
+        return bag;
+    }
+
+    //the kick from one pair if they overlap at t, added onto whatever the two have already been given this step
+    void push_apart(const std::array<long, DIMS>& lk, const particle<TIME, REAL, DIMS>& lp, const std::array<long, DIMS>& rk, const particle<TIME, REAL, DIMS>& rp_now, TIME t){
+        if(!settings.species.interacts(lp.species, rp_now.species)){
+            return;
+        }
+        const auto rp = advance_to_time(rp_now, t);
+        std::array<REAL, DIMS> normal{};
+        REAL dist = 0;
+        for(size_t i = 0; i<DIMS; i++){
+            normal[i] = rp.position[i]-lp.position[i];
+            dist += normal[i]*normal[i];
+        }
+        dist = std::sqrt(dist);
+        const REAL overlap = lp.radius+rp.radius-dist;
+        if(overlap <= REAL{0} || dist == REAL{0}){
+            return;
+        }
+
+        REAL closing = 0;
+        for(size_t i = 0; i<DIMS; i++){
+            normal[i] /= dist;
+            closing += (lp.velocity[i]-rp.velocity[i])*normal[i];
+        }
+        //the damping only ever slows them down, it never pulls them back together
+        const REAL force = std::max(settings.stiffness*overlap+settings.damping*closing, REAL{0});
+        const REAL impulse = force*settings.step;
+
+        auto& lkick = state.kicks.emplace(lp.id, std::make_pair(lk, std::array<REAL, DIMS>{})).first->second.second;
+        auto& rkick = state.kicks.emplace(rp.id, std::make_pair(rk, std::array<REAL, DIMS>{})).first->second.second;
+        for(size_t i = 0; i<DIMS; i++){
+            lkick[i] -= impulse*normal[i]/lp.mass;
+            rkick[i] += impulse*normal[i]/rp.mass;
+        }
+        state.touching.insert(lk);
+        state.touching.insert(rk);
+        state.contacts++;
+    }
+
+    void sweep(){
+        const TIME t = state.global_time;
+        state.kicks.clear();
+        state.touching.clear();
+        state.steps++;
+
+        for(const auto& skv : state.soft){
+            const auto& lk = skv.first;
+            auto lit = state.volumes.find(lk);
+            if(lit == state.volumes.end()){
+                continue;
+            }
+            for(const auto& lpkv : *lit->second){
+                const auto lp = advance_to_time(lpkv.second, t);
+                for_each_neighbour(lk, [&](const std::array<long, DIMS>& rk){
+                    auto rit = state.volumes.find(rk);
+                    if(rit == state.volumes.end() || !state.soft.count(rk)){
+                        //the colliders still have every pair with a particle outside of the taken volumes
+                        return;
+                    }
+                    //each pair is pushed once, from the lower id's side
+                    for(const auto& rpkv : *rit->second){
+                        if(rpkv.first <= lp.id){
+                            continue;
+                        }
+                        push_apart(lk, lp, rk, rpkv.second, t);
+                    }
+                });
+            }
+        }
+
+        for(const auto& kkv : state.kicks){
+            particle_delta_message<TIME, REAL, DIMS> kick{};
+            kick.volume_id = kkv.second.first;
+            kick.particle_id = kkv.first;
+            kick.dv = kkv.second.second;
+            kick.deferred_dv_time = std::numeric_limits<TIME>::infinity();
+            state.pending_deltas.push_back(kick);
+        }
+
+        //give back every volume that has settled down, its hits start being counted again from nothing
+        for(auto it = state.soft.begin(); it != state.soft.end();){
+            it->second = state.touching.count(it->first) ? 0 : it->second+1;
+            if(it->second >= settings.relax_steps){
+                state.pending_regions.push_back({it->first, false});
+                state.hits.erase(it->first);
+                state.given_back++;
+                it = state.soft.erase(it);
+            }else{
+                it++;
+            }
+        }
+    }
+
+    void internal_transition(){
+        state.global_time += time_advance();
+
+        //We just got here from the output function, we can clear the queued messages.
+        state.pending_deltas.clear();
+        state.pending_regions.clear();
+
+        if(state.next_step <= state.global_time){
+            sweep();
+            state.next_step = state.soft.size() ? state.global_time+settings.step : std::numeric_limits<TIME>::infinity();
+        }
+    }
+
+    void external_transition(TIME dt, typename cadmium::make_message_bags<input_ports>::type mbs) {
+        state.global_time += dt;
+        for(const auto& msg : cadmium::get_messages<typename soft_contact_defs<TIME, REAL, DIMS>::particle_announcement>(mbs)){
+            if(msg.volume_update->empty()){
+                //a volume that emptied out has nothing to push on, if it was taken over it counts as settled from then on
+                state.volumes.erase(msg.volume_id);
+                continue;
+            }
+            state.volumes[msg.volume_id] = msg.volume_update;
+        }
+
+        for(const auto& msg : cadmium::get_messages<typename soft_contact_defs<TIME, REAL, DIMS>::collider_delta>(mbs)){
+            //a delta with a deferred dv is one particle's side of a hit, anything else is only a kick
+            if(msg.deferred_dv_time == std::numeric_limits<TIME>::infinity() || state.soft.count(msg.volume_id)){
+                continue;
+            }
+            //a delta that only flushes a deferred dv did not hit anything, a pair looked at again after it stopped touching sends those
+            REAL dv2 = 0;
+            for(size_t i = 0; i<DIMS; i++){
+                const REAL dv = msg.dv[i]+msg.deferred_dv[i];
+                dv2 += dv*dv;
+            }
+            if(dv2 == REAL{0}){
+                continue;
+            }
+            auto& count = state.hits[msg.volume_id];
+            if(count.second == 0 || state.global_time-count.first > settings.handoff_window){
+                count = {state.global_time, 0};
+            }
+            if(++count.second >= settings.handoff_hits && settings.handoff_hits){
+                state.soft[msg.volume_id] = 0;
+                state.pending_regions.push_back({msg.volume_id, true});
+                state.taken++;
+                //the first step is straight away, the colliders have only just fired the hit that did it
+                state.next_step = std::min(state.next_step, state.global_time);
+            }
+        }
+    }
+
+    void confluence_transition(TIME, typename cadmium::make_message_bags<input_ports>::type mbs) {
+        internal_transition();
+        external_transition(TIME{}, std::move(mbs));
+    }
+
+
+    TIME time_advance() const {
+        if(state.pending_deltas.size() || state.pending_regions.size()){
+            return {0};
+        }else{
+            return std::max(state.next_step-state.global_time, {0});
+        }
+    }
+
+
+    friend std::ostream& operator<<(std::ostream& os, const soft_contact_model& scm) {
+        return os << scm.state;
+    }
+
+
+};
+
+
+
+}
+#endif /* __SOFT_CONTACT_MODEL_HPP__ */
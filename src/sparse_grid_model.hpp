@@ -0,0 +1,422 @@
+#ifndef __SPARSE_GRID_MODEL_HPP__
+#define __SPARSE_GRID_MODEL_HPP__
+
+
+#include <cadmium/modeling/ports.hpp>
+#include <cadmium/modeling/message_bag.hpp>
+
+#include <map>
+#include <set>
+#include <vector>
+#include <utility>
+#include <limits>
+#include <cmath>
+#include <string>
+#include <memory>
+#include <algorithm>
+
+#include "./particle.hpp"
+#include "./particle_moving_message.hpp"
+#include "./particle_delta_message.hpp"
+#include "./particle_announcement_message.hpp"
+#include "./volume_model.hpp"
+#include "./node_pool.hpp"
+#include "./log_filter.hpp"
+#include "./volume_neighbours.hpp"
+#include "./wire_format.hpp"
+#include "./spill_store.hpp"
+
+namespace tps{
+
+/*
+    A grid of volumes with no edges, where only the volumes that hold particles exist.
+    Cadmium can not add models to a coupled model once it is running, so the volumes live inside this one model instead,
+    each one is a plain volume_model that gets driven by hand, the same way the runner would drive it.
+
+    A volume is made the first time a particle heads for it, and dropped again once it has told everyone it is empty,
+    so memory and the work of scheduling follow the space the particles are in, not the box around them.
+    It talks through the same ports as a single volume, the announcements and deltas carry the volume_id they are about,
+    and anything listening has to let go of a volume once it announces it is empty, which the colliders and the other models in this repo do.
+    Particles headed past low or high are sent out of particle_leaving, for a sink to pick up.
+
+    With spill_path set, a volume whose particles are all resting, next to volumes that are all resting too, is written out to a spill_store
+    and dropped like an empty one. It announces an empty particle map so everything listening lets go of the map, but with nothing removed,
+    the particles are still in the run, just not in memory. The observers and auditors keep a share of their sums for each particle id,
+    so they carry on counting a spilled particle as it last was, which for a resting one is as it still is, and the colliders have nothing to do there anyway.
+    Nothing can reach a resting neighbourhood without a message to one of its volumes, so when one gets a message every spilled volume
+    around it is read back in first, and announces all of its particles in the same step as the volume that woke it, before anything can hit them.
+    Long range forces and snapshots need the particles themselves, make_sparse_grid marks a grid that spills so they refuse to be added to it.
+*/
+template<typename TIME, typename REAL, std::size_t DIMS>
+struct sparse_grid_model{
+    using volume_type = volume_model<TIME, REAL, DIMS>;
+    using volume_id = std::array<long, DIMS>;
+
+    struct settings_type{
+        //the low corner of volume {0, ..., 0}, and the extent of every volume, which must be positive
+        std::array<REAL, DIMS> corner{};
+        std::array<REAL, DIMS> volume_size{};
+
+        //the volume ids volumes can be made for, an empty bound lets everything through on that side
+        std::vector<long> low{};
+        std::vector<long> high{};
+
+        //handed to every volume, periodic axes are not supported here
+        typename volume_type::settings_type volume_settings{};
+
+        //a directory for the spill file, empty keeps every volume in memory
+        std::string spill_path{};
+    };
+    settings_type settings;
+
+    struct hosted_type{
+        volume_type volume{};
+        //when the volume next has something to do, also its key in schedule
+        TIME next{std::numeric_limits<TIME>::infinity()};
+    };
+
+    struct state_type{
+        TIME global_time{0};
+
+        std::map<volume_id, hosted_type> volumes{};
+        //every volume that has something to do, ordered by when
+        std::set<std::pair<TIME, volume_id>> schedule{};
+        node_pool<std::set<std::pair<TIME, volume_id>>> schedule_nodes{};
+
+        //volumes that went empty, they are dropped at the next internal transition, once everyone has heard that they are empty
+        std::vector<volume_id> emptied{};
+
+        //where each spilled volume's particles are, and the volumes that were just spilled and still have to say they are empty
+        std::map<volume_id, spill_store::extent> spilled{};
+        std::vector<volume_id> spilling{};
+        //volumes that announced in this step and may be quiet now, they are looked at again in the next step,
+        //once everything listening has read the map they announced
+        std::vector<volume_id> settling{};
+        //made the first time something is spilled, shared by copies of the model
+        std::shared_ptr<spill_store> store{};
+
+        //created counts every volume_model made, restores included
+        std::size_t created{0};
+        std::size_t retired{0};
+        std::size_t spills{0};
+        std::size_t restores{0};
+
+        friend std::ostream& operator<<(std::ostream& os, const state_type& state) {
+            const auto& filter = current_log_view().rules();
+            os << "{\"volumes\":[";
+            bool first = true;
+            for(const auto& kv : state.volumes){
+                if(!filter.volume(kv.first)){
+                    continue;
+                }
+                if(first){
+                    first = false;
+                }else{
+                    os << ", ";
+                }
+                os << kv.second.volume.state;
+            }
+            os << "], \"created\":" << state.created << ", \"retired\":" << state.retired;
+            if(state.spills){
+                os << ", \"spills\":" << state.spills << ", \"restores\":" << state.restores << ", \"spilled\":" << state.spilled.size();
+            }
+            return os << "}";
+        }
+    };
+    state_type state;
+
+    using input_ports = std::tuple<
+        typename volume_defs<TIME, REAL, DIMS>::particle_entering,
+        typename volume_defs<TIME, REAL, DIMS>::particle_delta
+    >;
+
+    using output_ports = std::tuple<
+        typename volume_defs<TIME, REAL, DIMS>::particle_leaving,
+        typename volume_defs<TIME, REAL, DIMS>::particle_announcement
+    >;
+
+    using volume_bags = typename cadmium::make_message_bags<typename volume_type::input_ports>::type;
+
+    sparse_grid_model<TIME, REAL, DIMS>(){};
+    sparse_grid_model<TIME, REAL, DIMS>(settings_type settings, std::vector<particle<TIME, REAL, DIMS>> particles = {}) : settings(std::move(settings)) {
+        //sort the particles into the volumes that hold them
+        std::map<volume_id, std::vector<particle<TIME, REAL, DIMS>>> contents{};
+        for(const auto& p : particles){
+            volume_id pid{};
+            for(size_t i = 0; i<DIMS; i++){
+                pid[i] = (long)std::floor((p.position[i]-this->settings.corner[i])/this->settings.volume_size[i]);
+            }
+            contents[pid].push_back(p);
+        }
+        for(auto& ckv : contents){
+            make_volume(ckv.first, std::move(ckv.second));
+        }
+    };
+
+    bool in_bounds(const volume_id& id) const {
+        for(size_t i = 0; i<DIMS; i++){
+            if((i < settings.low.size() && id[i] < settings.low[i]) || (i < settings.high.size() && id[i] > settings.high[i])){
+                return false;
+            }
+        }
+        return true;
+    }
+
+    hosted_type& make_volume(const volume_id& id, std::vector<particle<TIME, REAL, DIMS>> particles = {}){
+        std::array<REAL, DIMS> one_corner{};
+        for(size_t i = 0; i<DIMS; i++){
+            one_corner[i] = settings.corner[i]+id[i]*settings.volume_size[i];
+        }
+        auto& hosted = state.volumes[id];
+        hosted.volume = volume_type(id, one_corner, settings.volume_size, std::move(particles), settings.volume_settings);
+        hosted.volume.state.global_time = state.global_time;
+        state.created++;
+        reschedule(id, hosted);
+        return hosted;
+    }
+
+    void reschedule(const volume_id& id, hosted_type& hosted){
+        if(hosted.next != std::numeric_limits<TIME>::infinity()){
+            state.schedule_nodes.release(state.schedule, std::make_pair(hosted.next, id));
+        }
+        hosted.next = hosted.volume.state.global_time+hosted.volume.time_advance();
+        if(hosted.next != std::numeric_limits<TIME>::infinity()){
+            state.schedule_nodes.insert(state.schedule, std::make_pair(hosted.next, id));
+        }
+    }
+
+    //drops the volumes that went empty in an earlier transition, unless something has moved in since
+    void retire(){
+        for(const auto& id : state.emptied){
+            auto it = state.volumes.find(id);
+            if(it != state.volumes.end() && it->second.volume.state.particles.empty() && it->second.next == std::numeric_limits<TIME>::infinity()){
+                state.volumes.erase(it);
+                state.retired++;
+            }
+        }
+        state.emptied.clear();
+    }
+
+    //nothing in it or next to it can move, or be hit, until one of them gets a message
+    bool quiet(const volume_id& id) const {
+        auto it = state.volumes.find(id);
+        return it == state.volumes.end() || (it->second.volume.state.awake.empty() && it->second.next == std::numeric_limits<TIME>::infinity());
+    }
+
+    //spills every volume next to one in touched that can go, the ones in announced only get another look in the next step
+    void spill_quiet(const std::vector<volume_id>& touched, const std::vector<volume_id>& announced = {}){
+        if(settings.spill_path.empty()){
+            return;
+        }
+        for(const auto& tid : touched){
+            for_each_neighbour(tid, [&](const volume_id& id){
+                auto it = state.volumes.find(id);
+                if(it == state.volumes.end() || it->second.volume.state.particles.empty() || !quiet(id)){
+                    return;
+                }
+                bool neighbours_quiet = true;
+                for_each_neighbour(id, [&](const volume_id& nid){
+                    neighbours_quiet &= quiet(nid);
+                });
+                if(!neighbours_quiet){
+                    return;
+                }
+                if(std::find(announced.begin(), announced.end(), id) != announced.end()){
+                    state.settling.push_back(id);
+                }else{
+                    spill(id, it->second);
+                }
+            });
+        }
+    }
+
+    void spill(const volume_id& id, hosted_type& hosted){
+        if(!state.store){
+            state.store = std::make_shared<spill_store>(settings.spill_path);
+        }
+        std::vector<char> bytes{};
+        wire_writer out{bytes};
+        out.put(hosted.volume.state.particles.size());
+        for(const auto& pkv : hosted.volume.state.particles){
+            write_particle(out, pkv.second);
+        }
+        state.spilled[id] = state.store->put(bytes);
+        state.spills++;
+
+        //an empty volume in the same place, so the announcement still points at the map everyone has been reading
+        hosted.volume = volume_type(id, hosted.volume.state.one_corner, settings.volume_size, {}, settings.volume_settings);
+        hosted.volume.state.global_time = state.global_time;
+        state.spilling.push_back(id);
+    }
+
+    //reads back every spilled volume in the neighbourhood of id, they announce everything they hold at the next step
+    void restore_around(const volume_id& id){
+        if(state.spilled.empty()){
+            return;
+        }
+        for_each_neighbour(id, [&](const volume_id& nid){
+            auto sit = state.spilled.find(nid);
+            if(sit == state.spilled.end()){
+                return;
+            }
+            const auto bytes = state.store->take(sit->second);
+            state.spilled.erase(sit);
+            wire_reader in{bytes};
+            std::vector<particle<TIME, REAL, DIMS>> particles(in.get<std::size_t>());
+            for(auto& par : particles){
+                par = read_particle<TIME, REAL, DIMS>(in);
+            }
+            auto vit = state.volumes.find(nid);
+            if(vit != state.volumes.end()){
+                //it has not been dropped yet, or a particle has moved in since, either way it takes its particles back
+                auto& volume = vit->second.volume;
+                for(auto& par : particles){
+                    volume.take(par);
+                }
+                volume.state.global_time = state.global_time;
+                reschedule(nid, vit->second);
+            }else{
+                make_volume(nid, std::move(particles));
+            }
+            state.restores++;
+        });
+    }
+
+    //hands each volume its messages as one external transition, making the volumes that do not exist yet
+    void deliver(std::map<volume_id, volume_bags>& bags){
+        for(const auto& bkv : bags){
+            restore_around(bkv.first);
+        }
+        for(auto& bkv : bags){
+            auto it = state.volumes.find(bkv.first);
+            auto& hosted = it != state.volumes.end() ? it->second : make_volume(bkv.first);
+            hosted.volume.external_transition(std::max(state.global_time-hosted.volume.state.global_time, TIME{0}), std::move(bkv.second));
+            reschedule(bkv.first, hosted);
+        }
+    }
+
+    typename cadmium::make_message_bags<output_ports>::type output() const {
+        typename cadmium::make_message_bags<output_ports>::type bag;
+
+        auto& leaving = cadmium::get_messages<typename volume_defs<TIME, REAL, DIMS>::particle_leaving>(bag);
+        auto& announcements = cadmium::get_messages<typename volume_defs<TIME, REAL, DIMS>::particle_announcement>(bag);
+        for(const auto& id : state.spilling){
+            const auto& vol_state = state.volumes.at(id).volume.state;
+            announcements.push_back({id, &*vol_state.pending_updates, &*vol_state.pending_removals, &vol_state.particles, &vol_state.awake});
+        }
+        //a step that is only for the spilled and settling volumes has no volume due in it
+        if(state.schedule.empty() || ((state.spilling.size() || state.settling.size()) && state.schedule.begin()->first > state.global_time)){
+            return bag;
+        }
+
+        //every volume that is due now says what it has to say, only the particles leaving the bounds go any further than this model
+        const TIME now = state.schedule.begin()->first;
+        for(auto it = state.schedule.begin(); it != state.schedule.end() && it->first == now; it++){
+            const auto vol_bag = state.volumes.at(it->second).volume.output();
+            for(const auto& move_msg : cadmium::get_messages<typename volume_defs<TIME, REAL, DIMS>::particle_leaving>(vol_bag)){
+                if(!in_bounds(move_msg.destination_id)){
+                    leaving.push_back(move_msg);
+                }
+            }
+            const auto& vol_announcements = cadmium::get_messages<typename volume_defs<TIME, REAL, DIMS>::particle_announcement>(vol_bag);
+            announcements.insert(announcements.end(), vol_announcements.begin(), vol_announcements.end());
+        }
+
+        return bag;
+    }
+
+    void internal_transition(){
+        retire();
+        std::vector<volume_id> settled{};
+        settled.swap(state.settling);
+        const bool extra_step = state.spilling.size() || settled.size();
+        if(state.spilling.size()){
+            //the spilled volumes have said they are empty, they can be dropped next time, like any other empty volume
+            state.emptied.insert(state.emptied.end(), state.spilling.begin(), state.spilling.end());
+            state.spilling.clear();
+        }
+        if(extra_step && (state.schedule.empty() || state.schedule.begin()->first > state.global_time)){
+            spill_quiet(settled);
+            return;
+        }
+        //taken straight from the schedule, so the volumes that are due match it exactly
+        state.global_time = state.schedule.begin()->first;
+
+        std::vector<volume_id> due{};
+        for(auto it = state.schedule.begin(); it != state.schedule.end() && it->first == state.global_time; it++){
+            due.push_back(it->second);
+        }
+
+        //the particles moving between volumes go straight to the volumes they are headed for, after every volume that is due is done
+        //so a volume that is due and gets particles now goes through the same internal then external a confluence would give it
+        std::map<volume_id, volume_bags> bags{};
+        for(const auto& id : due){
+            auto& hosted = state.volumes.at(id);
+            for(const auto& move_msg : hosted.volume.state.pending_moves){
+                if(in_bounds(move_msg.destination_id)){
+                    cadmium::get_messages<typename volume_defs<TIME, REAL, DIMS>::particle_entering>(bags[move_msg.destination_id]).push_back(move_msg);
+                }
+            }
+            hosted.volume.internal_transition();
+            reschedule(id, hosted);
+        }
+        deliver(bags);
+
+        for(const auto& id : due){
+            const auto& hosted = state.volumes.at(id);
+            if(hosted.volume.state.particles.empty() && hosted.next == std::numeric_limits<TIME>::infinity()){
+                state.emptied.push_back(id);
+            }
+        }
+        //the volumes that are due have just announced, anything listening may still read their maps in this step
+        settled.insert(settled.end(), due.begin(), due.end());
+        spill_quiet(settled, due);
+    }
+
+    void external_transition(TIME dt, typename cadmium::make_message_bags<input_ports>::type mbs) {
+        state.global_time += dt;
+
+        std::map<volume_id, volume_bags> bags{};
+        for(const auto& move_msg : cadmium::get_messages<typename volume_defs<TIME, REAL, DIMS>::particle_entering>(mbs)){
+            if(in_bounds(move_msg.destination_id)){
+                cadmium::get_messages<typename volume_defs<TIME, REAL, DIMS>::particle_entering>(bags[move_msg.destination_id]).push_back(move_msg);
+            }
+        }
+        for(const auto& delta_msg : cadmium::get_messages<typename volume_defs<TIME, REAL, DIMS>::particle_delta>(mbs)){
+            //a delta for a volume that is gone has nothing left to act on
+            if(state.volumes.count(delta_msg.volume_id)){
+                cadmium::get_messages<typename volume_defs<TIME, REAL, DIMS>::particle_delta>(bags[delta_msg.volume_id]).push_back(delta_msg);
+            }
+        }
+        //every volume that got something announces it next step, and is looked at for spilling after that
+        deliver(bags);
+    }
+
+    void confluence_transition(TIME, typename cadmium::make_message_bags<input_ports>::type mbs) {
+        internal_transition();
+        external_transition(TIME{}, std::move(mbs));
+    }
+
+
+    TIME time_advance() const {
+        if(state.spilling.size() || state.settling.size()){
+            return {0};
+        }else if(state.schedule.empty()){
+            return std::numeric_limits<TIME>::infinity();
+        }else{
+            return std::max(state.schedule.begin()->first-state.global_time, {0});
+        }
+    }
+
+
+    friend std::ostream& operator<<(std::ostream& os, const sparse_grid_model& grid) {
+        return os << grid.state;
+    }
+
+
+};
+
+
+
+}
+#endif /* __SPARSE_GRID_MODEL_HPP__ */
@@ -0,0 +1,95 @@
+#ifndef __SPECIES_INTERACTIONS_HPP__
+#define __SPECIES_INTERACTIONS_HPP__
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <string>
+#include <stdexcept>
+
+namespace tps{
+
+//how two particles act when they meet, the last three are handed straight to blocking_collide
+template<typename TIME, typename REAL>
+struct species_interaction{
+    //false lets the two pass through each other, the collider never even works out when they would meet
+    bool collide{true};
+    REAL losses{0};
+    TIME stick_time{0.000001};
+    REAL extra_push{0.001};
+};
+
+/*
+    A species x species table of interactions, always symmetric.
+    Any pair that was never set gets fallback, so an empty table treats every pair like the colliders always have.
+    Species ids can be anything below max_species, the ones that are named in a rule get dense indices in the order they first turn up,
+    so the square is only as big as the number of species that have rules, however big their ids are.
+    The lookup is two loads from index and one from the flat square of slots, it sits in the collider's pair loop so it has to stay cheap.
+*/
+template<typename TIME, typename REAL>
+struct species_table{
+    using rule_type = species_interaction<TIME, REAL>;
+
+    static constexpr std::size_t max_species = std::size_t{1} << 20;
+
+    rule_type fallback{};
+
+    //the rules that were set, a slot of 0 is fallback, n is rules[n-1]
+    std::vector<rule_type> rules{};
+    std::vector<std::uint32_t> slots{};
+    //the dense index of each species id, plus one, 0 for a species no rule names
+    std::vector<std::uint32_t> index{};
+    std::size_t species{0};
+
+    //the dense index of id, giving it the next one, and the square another row and column, if it does not have one yet
+    std::size_t dense(std::size_t id){
+        if(id >= max_species){
+            throw std::invalid_argument("species ids have to be below " + std::to_string(max_species) + ", got " + std::to_string(id));
+        }
+        if(id >= index.size()){
+            index.resize(id+1, 0);
+        }
+        if(!index[id]){
+            const std::size_t grown_size = species+1;
+            std::vector<std::uint32_t> grown(grown_size*grown_size, 0);
+            for(std::size_t i = 0; i<species; i++){
+                for(std::size_t j = 0; j<species; j++){
+                    grown[i*grown_size+j] = slots[i*species+j];
+                }
+            }
+            slots.swap(grown);
+            species = grown_size;
+            index[id] = (std::uint32_t)species;
+        }
+        return index[id]-1;
+    }
+
+    //setting a pair again replaces its rule
+    void set(std::size_t a, std::size_t b, const rule_type& rule){
+        const std::size_t i = dense(a);
+        const std::size_t j = dense(b);
+        const auto slot = slots[i*species+j];
+        if(slot){
+            rules[slot-1] = rule;
+            return;
+        }
+        rules.push_back(rule);
+        slots[i*species+j] = (std::uint32_t)rules.size();
+        slots[j*species+i] = (std::uint32_t)rules.size();
+    }
+
+    const rule_type& at(std::size_t a, std::size_t b) const {
+        if(a >= index.size() || b >= index.size() || !index[a] || !index[b]){
+            return fallback;
+        }
+        const auto slot = slots[(index[a]-1)*species+(index[b]-1)];
+        return slot ? rules[slot-1] : fallback;
+    }
+
+    bool interacts(std::size_t a, std::size_t b) const {
+        return at(a, b).collide;
+    }
+};
+
+}
+#endif /* __SPECIES_INTERACTIONS_HPP__ */
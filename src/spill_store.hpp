@@ -0,0 +1,163 @@
+#ifndef __SPILL_STORE_HPP__
+#define __SPILL_STORE_HPP__
+
+#include <cstddef>
+#include <cstring>
+#include <cerrno>
+#include <map>
+#include <vector>
+#include <iterator>
+#include <string>
+#include <system_error>
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+
+namespace tps{
+
+/*
+    Byte blobs kept in a file that is mapped into memory, for state that will not be looked at for a long time.
+    The pages of a blob are handed back to the kernel as soon as it is written, so it only takes up page cache,
+    which the kernel writes out to the file and drops whenever it wants the memory back, and reads in again when the blob is taken.
+
+    The file is unlinked as soon as it is made, path only picks where it lives, and nothing is left behind when the store goes away.
+    Space freed by take is reused first fit, the file only grows when nothing free is big enough.
+*/
+class spill_store{
+public:
+    struct extent{
+        std::size_t offset{0};
+        std::size_t size{0};
+    };
+
+private:
+    int fd{-1};
+    char* base{nullptr};
+    std::size_t capacity{0};
+    std::size_t end{0};
+    //offset -> size of each free gap below end, neighbouring gaps are always merged
+    std::map<std::size_t, std::size_t> free_extents{};
+
+    static std::system_error error(const char* what){
+        return std::system_error(errno, std::generic_category(), what);
+    }
+
+    static std::size_t page(){
+        static const std::size_t size = (std::size_t)sysconf(_SC_PAGESIZE);
+        return size;
+    }
+
+    void grow(std::size_t needed){
+        std::size_t next = capacity ? capacity : 16*page();
+        while(next < needed){
+            next *= 2;
+        }
+        if(ftruncate(fd, (off_t)next)){
+            throw error("ftruncate");
+        }
+        if(base){
+            munmap(base, capacity);
+        }
+        void* mapped = mmap(nullptr, next, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if(mapped == MAP_FAILED){
+            base = nullptr;
+            capacity = 0;
+            throw error("mmap");
+        }
+        base = static_cast<char*>(mapped);
+        capacity = next;
+    }
+
+    //the whole pages inside [offset, offset+size), partial pages at either end may hold a neighbour's bytes
+    void drop_pages(std::size_t offset, std::size_t size){
+        const std::size_t first = (offset+page()-1)/page()*page();
+        const std::size_t last = (offset+size)/page()*page();
+        if(last > first){
+            madvise(base+first, last-first, MADV_DONTNEED);
+        }
+    }
+
+public:
+    explicit spill_store(const std::string& path){
+        std::string name = path + "/tps_spill_XXXXXX";
+        fd = mkstemp(&name[0]);
+        if(fd < 0){
+            throw error("mkstemp");
+        }
+        unlink(name.c_str());
+    }
+
+    spill_store(const spill_store&) = delete;
+    spill_store& operator=(const spill_store&) = delete;
+
+    ~spill_store(){
+        if(base){
+            munmap(base, capacity);
+        }
+        if(fd >= 0){
+            close(fd);
+        }
+    }
+
+    extent put(const std::vector<char>& bytes){
+        extent at{0, bytes.size()};
+        auto it = free_extents.begin();
+        while(it != free_extents.end() && it->second < bytes.size()){
+            it++;
+        }
+        if(it != free_extents.end()){
+            at.offset = it->first;
+            const std::size_t left = it->second-bytes.size();
+            free_extents.erase(it);
+            if(left){
+                free_extents[at.offset+bytes.size()] = left;
+            }
+        }else{
+            at.offset = end;
+            if(end+bytes.size() > capacity){
+                grow(end+bytes.size());
+            }
+            end += bytes.size();
+        }
+        std::memcpy(base+at.offset, bytes.data(), bytes.size());
+        drop_pages(at.offset, at.size);
+        return at;
+    }
+
+    //copies the blob back out and frees its space
+    std::vector<char> take(const extent& at){
+        std::vector<char> bytes(base+at.offset, base+at.offset+at.size);
+
+        std::size_t offset = at.offset;
+        std::size_t size = at.size;
+        auto after = free_extents.lower_bound(offset);
+        if(after != free_extents.begin()){
+            auto before = std::prev(after);
+            if(before->first+before->second == offset){
+                offset = before->first;
+                size += before->second;
+                free_extents.erase(before);
+            }
+        }
+        if(after != free_extents.end() && offset+size == after->first){
+            size += after->second;
+            free_extents.erase(after);
+        }
+        if(offset+size == end){
+            end = offset;
+        }else{
+            free_extents[offset] = size;
+        }
+        drop_pages(offset, size);
+        return bytes;
+    }
+
+    //bytes of the file in use, including free gaps
+    std::size_t size() const {
+        return end;
+    }
+};
+
+}
+#endif /* __SPILL_STORE_HPP__ */
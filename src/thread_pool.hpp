@@ -0,0 +1,113 @@
+#ifndef __THREAD_POOL_HPP__
+#define __THREAD_POOL_HPP__
+
+#include <cstddef>
+#include <atomic>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <functional>
+#include <condition_variable>
+
+namespace tps{
+
+/*
+    A fixed set of threads for splitting one loop over many cores, for work inside a single transition.
+    parallel_for hands out the indices one at a time from a shared counter, so a thread that runs out of work just takes the next index,
+    and a few slow items do not hold up the items queued behind them. The calling thread works too, and it returns once every index is done.
+    Which thread runs which index is not fixed, anything that has to come out the same every run should be written per index and merged after.
+*/
+class thread_pool{
+    std::vector<std::thread> workers{};
+
+    std::mutex lock{};
+    std::condition_variable wake{};
+    std::condition_variable finished{};
+
+    //the loop that is running, generation goes up by one for each call to parallel_for
+    std::function<void(std::size_t)> job{};
+    std::size_t count{0};
+    std::size_t generation{0};
+    std::atomic<std::size_t> next{0};
+    std::size_t busy{0};
+    bool stopping{false};
+
+    void run_job(){
+        for(std::size_t i = next.fetch_add(1); i < count; i = next.fetch_add(1)){
+            job(i);
+        }
+    }
+
+    void work(){
+        std::size_t seen = 0;
+        std::unique_lock<std::mutex> guard(lock);
+        while(true){
+            wake.wait(guard, [&]{ return stopping || generation != seen; });
+            if(stopping){
+                return;
+            }
+            seen = generation;
+            busy++;
+            guard.unlock();
+            run_job();
+            guard.lock();
+            if(--busy == 0){
+                finished.notify_all();
+            }
+        }
+    }
+
+public:
+    //threads counts the calling thread, so 1 makes no threads and runs every loop in line
+    explicit thread_pool(std::size_t threads){
+        for(std::size_t t = 1; t < threads; t++){
+            workers.emplace_back([this]{ work(); });
+        }
+    }
+
+    thread_pool(const thread_pool&) = delete;
+    thread_pool& operator=(const thread_pool&) = delete;
+
+    ~thread_pool(){
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            stopping = true;
+        }
+        wake.notify_all();
+        for(auto& w : workers){
+            w.join();
+        }
+    }
+
+    std::size_t size() const {
+        return workers.size()+1;
+    }
+
+    //calls f(i) for every i in [0, n), from any of the threads, and returns when they have all returned
+    template<typename F>
+    void parallel_for(std::size_t n, F&& f){
+        if(workers.empty() || n < 2){
+            for(std::size_t i = 0; i<n; i++){
+                f(i);
+            }
+            return;
+        }
+        std::unique_lock<std::mutex> guard(lock);
+        //a worker that woke up late for the last loop may still be looking at it, it finds nothing left to do but has to be let go first
+        finished.wait(guard, [&]{ return busy == 0; });
+        job = std::ref(f);
+        count = n;
+        next = 0;
+        generation++;
+        guard.unlock();
+        wake.notify_all();
+
+        run_job();
+
+        guard.lock();
+        finished.wait(guard, [&]{ return busy == 0; });
+    }
+};
+
+}
+#endif /* __THREAD_POOL_HPP__ */
@@ -0,0 +1,234 @@
+#ifndef __TRANSITION_TRACE_HPP__
+#define __TRANSITION_TRACE_HPP__
+
+#include <cstddef>
+#include <cstdint>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <tuple>
+#include <ostream>
+#include <cmath>
+
+#include <cadmium/modeling/message_bag.hpp>
+
+#include "./wire_format.hpp"
+#include "./volume_model.hpp"
+#include "./blocking_collider_model.hpp"
+#include "./sparse_grid_model.hpp"
+
+namespace tps{
+
+enum class trace_kind : std::uint8_t{
+    output,
+    internal,
+    external,
+    confluence,
+};
+
+inline const char* trace_kind_name(trace_kind kind){
+    switch(kind){
+        case trace_kind::output: return "output";
+        case trace_kind::internal: return "internal";
+        case trace_kind::external: return "external";
+        default: return "confluence";
+    }
+}
+
+//one call into one model, times are in nanoseconds from when the trace was made
+struct trace_span{
+    std::uint32_t model;
+    trace_kind kind;
+    double time;                    //simulated time after the call
+    double time_advance;            //what the model asked for after the call, a long run of 0s is a storm
+    std::int64_t start;
+    std::int64_t duration;
+    std::uint32_t messages;         //messages in for transitions that get any, messages out for output
+};
+
+/*
+    Every transition and output call of every traced model, kept in memory until the run is over.
+    There is one of these per process, see active_trace, models only show up in it when they are wrapped in traced_model.
+
+    write_chrome_json gives the Chrome trace event format, which chrome://tracing and ui.perfetto.dev both open, one row per model.
+    write_binary is the same spans in wire_format, a header then one record per span, for runs too long for JSON.
+*/
+struct transition_trace{
+    std::chrono::steady_clock::time_point began{std::chrono::steady_clock::now()};
+    std::vector<std::string> labels{};
+    std::vector<trace_span> spans{};
+    //the parallel runner can call models from more than one thread
+    std::mutex lock{};
+
+    //make_label gets the id the model will have, so it can be part of the label
+    template<typename F>
+    std::uint32_t add_model(F&& make_label){
+        std::lock_guard<std::mutex> guard(lock);
+        const auto id = (std::uint32_t)labels.size();
+        labels.push_back(make_label(id));
+        return id;
+    }
+
+    std::int64_t now() const {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now()-began).count();
+    }
+
+    void record(const trace_span& span){
+        std::lock_guard<std::mutex> guard(lock);
+        spans.push_back(span);
+    }
+
+    void write_chrome_json(std::ostream& os){
+        std::lock_guard<std::mutex> guard(lock);
+        os << "{\"traceEvents\":[";
+        bool first = true;
+        for(std::size_t m = 0; m<labels.size(); m++){
+            os << (first ? "\n" : ",\n") << "{\"name\":\"thread_name\", \"ph\":\"M\", \"pid\":0, \"tid\":" << m << ", \"args\":{\"name\":\"" << labels[m] << "\"}}";
+            first = false;
+        }
+        //JSON has no infinity, a model that is waiting on nothing gets a string instead
+        auto number = [&](double value) -> std::ostream& {
+            if(std::isinf(value)){
+                return os << (value > 0 ? "\"inf\"" : "\"-inf\"");
+            }
+            return os << value;
+        };
+        //chrome wants microseconds, the fraction keeps short calls from all showing up as 0
+        for(const auto& span : spans){
+            os << (first ? "\n" : ",\n") << "{\"name\":\"" << trace_kind_name(span.kind) << "\", \"ph\":\"X\", \"pid\":0, \"tid\":" << span.model
+               << ", \"ts\":" << span.start/1000.0 << ", \"dur\":" << span.duration/1000.0 << ", \"args\":{\"time\":";
+            number(span.time) << ", \"time_advance\":";
+            number(span.time_advance) << ", \"messages\":" << span.messages << "}}";
+            first = false;
+        }
+        os << "\n]}\n";
+    }
+
+    void write_binary(std::ostream& os){
+        std::lock_guard<std::mutex> guard(lock);
+        std::vector<char> buffer{};
+        wire_writer writer{buffer};
+        for(const char c : {'T', 'P', 'S', 'T'}){
+            writer.put(c);
+        }
+        writer.put((std::uint64_t)labels.size());
+        for(const auto& label : labels){
+            writer.put((std::uint64_t)label.size());
+            for(const char c : label){
+                writer.put(c);
+            }
+        }
+        writer.put((std::uint64_t)spans.size());
+        for(const auto& span : spans){
+            writer.put(span.model);
+            writer.put(span.kind);
+            writer.put(span.time);
+            writer.put(span.time_advance);
+            writer.put(span.start);
+            writer.put(span.duration);
+            writer.put(span.messages);
+        }
+        os.write(buffer.data(), buffer.size());
+    }
+};
+
+inline transition_trace& active_trace(){
+    static transition_trace trace{};
+    return trace;
+}
+
+//what a model is called in the trace, volumes go by their id like their model names do
+template<typename MODEL>
+std::string trace_label(const MODEL&, std::uint32_t n){
+    return "model_" + std::to_string(n);
+}
+
+template<typename TIME, typename REAL, std::size_t DIMS>
+std::string trace_label(const volume_model<TIME, REAL, DIMS>& vol, std::uint32_t){
+    std::string name = "vol";
+    for(size_t i = 0; i<DIMS; i++){
+        name += "_" + std::to_string(vol.state.volume_id[i]);
+    }
+    return name;
+}
+
+//a collider shard goes by the first volume it owns, its model name is not something it knows
+template<typename TIME, typename REAL, std::size_t DIMS>
+std::string trace_label(const blocking_collider_model<TIME, REAL, DIMS>& col, std::uint32_t){
+    std::string name = "b_col";
+    if(col.settings.owned_volumes.size()){
+        name += "_from";
+        for(size_t i = 0; i<DIMS; i++){
+            name += "_" + std::to_string(col.settings.owned_volumes.begin()->at(i));
+        }
+    }
+    return name;
+}
+
+template<typename TIME, typename REAL, std::size_t DIMS>
+std::string trace_label(const sparse_grid_model<TIME, REAL, DIMS>&, std::uint32_t){
+    return "sparse_grid";
+}
+
+template<typename BAGS>
+std::uint32_t count_messages(const BAGS& bags){
+    return std::apply([](const auto&... bag){ return (std::uint32_t)(bag.messages.size() + ... + 0); }, bags);
+}
+
+/*
+    A model that does exactly what MODEL does, and records how long each of its calls takes in active_trace.
+    grid_topology wraps its volumes, colliders and sparse grids in this when TPS_TRACE is defined.
+*/
+template<typename MODEL>
+struct traced_model : public MODEL{
+    using MODEL::MODEL;
+    using input_bags = typename cadmium::make_message_bags<typename MODEL::input_ports>::type;
+    using output_bags = typename cadmium::make_message_bags<typename MODEL::output_ports>::type;
+
+    //the label is taken on the first call, the model's constructor has to have filled it in by then
+    mutable std::uint32_t trace_id{(std::uint32_t)-1};
+
+    void trace(trace_kind kind, std::int64_t start, std::uint32_t messages) const {
+        auto& trace = active_trace();
+        const auto end = trace.now();
+        if(trace_id == (std::uint32_t)-1){
+            trace_id = trace.add_model([this](std::uint32_t id){ return trace_label(static_cast<const MODEL&>(*this), id); });
+        }
+        trace.record({trace_id, kind, (double)this->state.global_time, (double)MODEL::time_advance(), start, end-start, messages});
+    }
+
+    output_bags output() const {
+        const auto start = active_trace().now();
+        auto bags = MODEL::output();
+        trace(trace_kind::output, start, count_messages(bags));
+        return bags;
+    }
+
+    void internal_transition(){
+        const auto start = active_trace().now();
+        MODEL::internal_transition();
+        trace(trace_kind::internal, start, 0);
+    }
+
+    void external_transition(decltype(MODEL::state.global_time) dt, input_bags mbs){
+        const auto start = active_trace().now();
+        const auto messages = count_messages(mbs);
+        MODEL::external_transition(dt, std::move(mbs));
+        trace(trace_kind::external, start, messages);
+    }
+
+    void confluence_transition(decltype(MODEL::state.global_time) dt, input_bags mbs){
+        const auto start = active_trace().now();
+        const auto messages = count_messages(mbs);
+        MODEL::confluence_transition(dt, std::move(mbs));
+        trace(trace_kind::confluence, start, messages);
+    }
+
+    friend std::ostream& operator<<(std::ostream& os, const traced_model& model) {
+        return os << static_cast<const MODEL&>(model);
+    }
+};
+
+}
+#endif /* __TRANSITION_TRACE_HPP__ */
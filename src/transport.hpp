@@ -0,0 +1,167 @@
+#ifndef __TRANSPORT_HPP__
+#define __TRANSPORT_HPP__
+
+#include <cstdint>
+#include <cstring>
+#include <cerrno>
+#include <array>
+#include <vector>
+#include <string>
+#include <memory>
+#include <system_error>
+
+#include <unistd.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+namespace tps{
+
+/*
+    A link between two processes that run parts of the same simulation.
+    exchange is symmetric: both ends call it with what they have for the other, and both get back what the other sent.
+    Anything that can do that (sockets, shared memory, MPI) can be dropped in behind this.
+*/
+class transport{
+public:
+    virtual ~transport() = default;
+    virtual void exchange(const std::vector<char>& out, std::vector<char>& in) = 0;
+};
+
+/*
+    A transport over a connected AF_UNIX stream socket.
+    Each exchange is one frame each way, an 8 byte length and then the bytes.
+    Sending and receiving are interleaved with poll so two large frames going opposite ways can not fill both socket buffers and stall.
+*/
+class unix_socket_transport : public transport{
+    int fd;
+
+    static std::system_error error(const char* what){
+        return std::system_error(errno, std::generic_category(), what);
+    }
+
+public:
+    explicit unix_socket_transport(int fd) : fd(fd) {}
+    unix_socket_transport(const unix_socket_transport&) = delete;
+    unix_socket_transport& operator=(const unix_socket_transport&) = delete;
+
+    ~unix_socket_transport() override {
+        if(fd >= 0){
+            close(fd);
+        }
+    }
+
+    //two connected ends, hand one to each side of a fork
+    static std::array<int, 2> make_pair(){
+        std::array<int, 2> fds{};
+        if(socketpair(AF_UNIX, SOCK_STREAM, 0, fds.data())){
+            throw error("socketpair");
+        }
+        return fds;
+    }
+
+    //wait for one peer to connect on path
+    static std::shared_ptr<unix_socket_transport> listen_on(const std::string& path){
+        int server = socket(AF_UNIX, SOCK_STREAM, 0);
+        if(server < 0){
+            throw error("socket");
+        }
+        sockaddr_un addr{};
+        addr.sun_family = AF_UNIX;
+        std::strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path)-1);
+        unlink(path.c_str());
+        if(bind(server, (sockaddr*)&addr, sizeof(addr)) || listen(server, 1)){
+            close(server);
+            throw error("bind/listen");
+        }
+        int fd = accept(server, nullptr, nullptr);
+        close(server);
+        unlink(path.c_str());
+        if(fd < 0){
+            throw error("accept");
+        }
+        return std::make_shared<unix_socket_transport>(fd);
+    }
+
+    //connect to a peer that is listening on path, retrying while it starts up
+    static std::shared_ptr<unix_socket_transport> connect_to(const std::string& path, int attempts = 100){
+        sockaddr_un addr{};
+        addr.sun_family = AF_UNIX;
+        std::strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path)-1);
+        for(int i = 0; i<attempts; i++){
+            int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+            if(fd < 0){
+                throw error("socket");
+            }
+            if(!connect(fd, (sockaddr*)&addr, sizeof(addr))){
+                return std::make_shared<unix_socket_transport>(fd);
+            }
+            close(fd);
+            usleep(10000);
+        }
+        throw error("connect");
+    }
+
+    void exchange(const std::vector<char>& out, std::vector<char>& in) override {
+        const std::uint64_t out_size = out.size();
+        std::uint64_t in_size = 0;
+
+        std::size_t sent = 0;               //counts the header then the body
+        std::size_t received = 0;           //same
+        const std::size_t header = sizeof(std::uint64_t);
+
+        in.clear();
+        while(sent < header+out_size || received < header+in_size){
+            const bool want_out = sent < header+out_size;
+            const bool want_in = received < header || received < header+in_size;
+            pollfd p{fd, 0, 0};
+            if(want_out){
+                p.events |= POLLOUT;
+            }
+            if(want_in){
+                p.events |= POLLIN;
+            }
+            if(poll(&p, 1, -1) < 0){
+                if(errno == EINTR){
+                    continue;
+                }
+                throw error("poll");
+            }
+
+            if(want_out && (p.revents & POLLOUT)){
+                ssize_t n;
+                if(sent < header){
+                    n = send(fd, ((const char*)&out_size)+sent, header-sent, MSG_NOSIGNAL | MSG_DONTWAIT);
+                }else{
+                    n = send(fd, out.data()+(sent-header), header+out_size-sent, MSG_NOSIGNAL | MSG_DONTWAIT);
+                }
+                if(n < 0 && errno != EINTR && errno != EAGAIN){
+                    throw error("send");
+                }
+                sent += n > 0 ? n : 0;
+            }
+
+            if(want_in && (p.revents & (POLLIN | POLLHUP | POLLERR))){
+                ssize_t n;
+                if(received < header){
+                    n = recv(fd, ((char*)&in_size)+received, header-received, MSG_DONTWAIT);
+                }else{
+                    n = recv(fd, in.data()+(received-header), header+in_size-received, MSG_DONTWAIT);
+                }
+                if(n == 0){
+                    throw std::system_error(ECONNRESET, std::generic_category(), "peer closed the transport");
+                }
+                if(n < 0 && errno != EINTR && errno != EAGAIN){
+                    throw error("recv");
+                }
+                received += n > 0 ? n : 0;
+                if(received == header){
+                    in.resize(in_size);
+                }
+            }
+        }
+    }
+};
+
+}
+#endif /* __TRANSPORT_HPP__ */
@@ -6,13 +6,21 @@
 #include <cadmium/modeling/message_bag.hpp>
 
 #include <map>
+#include <set>
 #include <vector>
 #include <utility>
+#include <algorithm>
+#include <functional>
 
 #include "./particle.hpp"
 #include "./particle_moving_message.hpp"
 #include "./particle_delta_message.hpp"
 #include "./particle_announcement_message.hpp"
+#include "./node_pool.hpp"
+#include "./double_buffer.hpp"
+#include "./coalescing_error.hpp"
+#include "./periodic_boundary.hpp"
+#include "./log_filter.hpp"
 
 namespace tps{
 
@@ -30,6 +38,20 @@ struct volume_defs{
 template<typename TIME, typename REAL, std::size_t DIMS>
 struct volume_model{
 
+    struct settings_type{
+        //every event due within this long after the next one is held back and handled in the same transition instead of getting its own
+        //0 keeps every event at its exact time, see coalescing_error for what a non zero tolerance costs
+        TIME coalesce_tolerance{0};
+
+        //axes that wrap around, a particle leaving off the end of one comes back in at the other end
+        periodic_extent<REAL, DIMS> periodic{};
+
+        //the particle map is laid out again once this many particles have come in since the last time, see relayout
+        //0, the default, never does, set it for volumes with a lot of particles coming and going
+        std::size_t relayout_after{0};
+    };
+    settings_type settings;
+
     struct state_type{
         /* These fields are core to the functioning of this model */
         std::array<long, DIMS> volume_id;
@@ -38,16 +60,43 @@ struct volume_model{
         std::map<std::size_t, particle<TIME, REAL, DIMS>> particles{};
 
 
-        /* These fields are here to make outputing possible */
-        std::vector<size_t> pending_updates{};
-        std::vector<size_t> pending_removals{};
+        /* These fields are here to make outputing possible
+           the announcements point at the ids instead of copying them, and each internal transition flips to the other side of these,
+           so the side that went out is still there for every receiver's transition */
+        double_buffer<std::vector<size_t>> pending_updates{};
+        double_buffer<std::vector<size_t>> pending_removals{};
         std::vector<particle_moving_message<TIME, REAL, DIMS>> pending_moves{};
 
         /* These fields are here to make that functioning faster */
         TIME next_internal_time{std::numeric_limits<TIME>::infinity()};
+        node_pool<std::map<std::size_t, particle<TIME, REAL, DIMS>>> particle_nodes{};
+        std::size_t arrivals{0};
+
+        /* the particles that are not resting, only these can have an event, the colliders only look for hits with one of these in them */
+        std::set<std::size_t> awake{};
+        node_pool<std::set<std::size_t>> awake_nodes{};
+
+        /* every awake particle under the time of its next event here, leaving or its deferred dv landing, soonest first
+           each transition only takes the ones off the front that are due, so a particle that is just crossing the volume,
+           with nothing to hit on the way, is looked at once when it comes in and once more when it gets to the far side */
+        std::set<std::pair<TIME, std::size_t>> due{};
+        node_pool<std::set<std::pair<TIME, std::size_t>>> due_nodes{};
+        std::vector<std::size_t> due_now{};
 
         /* everything in this model runs on absolute time, not reletive time, so we need this */
-        TIME global_time;
+        TIME global_time{0};
+
+        /* how much accuracy coalescing has cost so far, this stays empty unless settings.coalesce_tolerance is set
+           position stays 0 here, a deferred dv held back here still goes in at the time it was due, see coalescing_error */
+        coalescing_error<TIME, REAL> coalesced{};
+
+        /* how many transitions there have been, and which one last cleared the pending lists, see log_filter::keyframe_every
+           and how many records of this volume were written to the state log and after which transition the last one was,
+           those two are only ever touched by writing this out, nothing in the model goes by them */
+        std::size_t transitions{0};
+        std::size_t cleared_at{0};
+        mutable std::size_t records{0};
+        mutable std::size_t recorded_at{0};
 
         bool operator<(const state_type& state){
             return volume_id<state.volume_id;
@@ -58,6 +107,11 @@ struct volume_model{
         }
 
         friend std::ostream& operator<<(std::ostream& os, const state_type& state) {
+            const auto& view = current_log_view();
+            const auto& filter = view.rules();
+            if(!view.open || !filter.states || !filter.volume(state.volume_id)){
+                return os;
+            }
 
             os << "{\"id\":[";
 
@@ -86,19 +140,76 @@ struct volume_model{
                 os << state.size[i];
             }
 
-            os << "], \"particles\":[";
+            //the pending lists hold everything since they were last cleared, so unless they were cleared after a transition that was never written,
+            //they are everything that changed since the last record, and that has to be a keyframe instead
+            const bool keyframe = !filter.keyframe_every || state.records % filter.keyframe_every == 0 || state.cleared_at > state.recorded_at+1;
+            //written again with no transition since, nothing has changed
+            const bool unchanged = state.recorded_at == state.transitions;
+            state.records++;
+            state.recorded_at = state.transitions;
+            if(keyframe){
+                os << "], \"particles\":[";
+
+                bool first = true;
+                for(const auto& kv : state.particles){
+                    if(!filter.particle(kv.second.id, kv.second.species)){
+                        continue;
+                    }
+                    if(first){//if we are not on the first element
+                        first = false;
+                    }else{
+                        os << ", ";
+                    }
+                    os << kv.second;
+                }
 
-            bool first = true;
-            for(const auto& kv : state.particles){
-                if(first){//if we are not on the first element
-                    first = false;
-                }else{
-                    os << ", ";
+                os << "]";
+            }else{
+                //a particle can be announced more than once in a transition, it is only written once, in id order
+                std::vector<std::size_t> ids{};
+                if(!unchanged){
+                    ids.assign(state.pending_updates->begin(), state.pending_updates->end());
                 }
-                os << kv.second;
+                std::sort(ids.begin(), ids.end());
+                ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+
+                os << "], \"changed\":[";
+                bool first = true;
+                for(auto id : ids){
+                    auto it = state.particles.find(id);
+                    if(it == state.particles.end() || !filter.particle(id, it->second.species)){
+                        continue;
+                    }
+                    if(first){
+                        first = false;
+                    }else{
+                        os << ", ";
+                    }
+                    os << it->second;
+                }
+
+                //one that left and came straight back in is in changed
+                os << "], \"removed\":[";
+                first = true;
+                for(auto id : *state.pending_removals){
+                    if(unchanged || state.particles.count(id) || !filter.particle_id(id)){
+                        continue;
+                    }
+                    if(first){
+                        first = false;
+                    }else{
+                        os << ", ";
+                    }
+                    os << id;
+                }
+                os << "]";
             }
 
-            return os << "]}";
+            if(state.coalesced.coalesced_events){
+                os << ", \"coalescing\":" << state.coalesced;
+            }
+
+            return os << "}";
 
         }
 
@@ -127,104 +238,216 @@ struct volume_model{
             std::array<long, DIMS> volume_id,
             std::array<REAL, DIMS> one_corner,
             std::array<REAL, DIMS> size,
-            std::vector<particle<TIME, REAL, DIMS>> particles = {}
-        ){
+            std::vector<particle<TIME, REAL, DIMS>> particles = {},
+            settings_type settings = {}
+        ) : settings(settings) {
         state.volume_id = volume_id;
         state.one_corner = one_corner;
         state.size = size;
 
         for(auto& p : particles){
-            state.particles[p.id] = p;
-            state.pending_updates.push_back(p.id);
+            take(p);
+        }
+    }
+
+    //the time of the particle's next event here, it is also the key the particle sits under in state.due, so it has to be taken before the particle changes
+    TIME next_event_time(const particle<TIME, REAL, DIMS>& par) const {
+        return std::min(move_out_time(par, state.one_corner, state.size), par.deferred_dv_time);
+    }
+
+    void schedule(const particle<TIME, REAL, DIMS>& par){
+        const TIME t = next_event_time(par);
+        if(t != std::numeric_limits<TIME>::infinity()){
+            state.due_nodes.insert(state.due, std::make_pair(t, par.id));
+        }
+    }
+
+    void unschedule(const particle<TIME, REAL, DIMS>& par){
+        state.due_nodes.release(state.due, std::make_pair(next_event_time(par), par.id));
+    }
+
+    //puts a particle in, over any with the same id, and queues an update about it
+    void take(const particle<TIME, REAL, DIMS>& par){
+        auto it = state.particles.find(par.id);
+        if(it != state.particles.end()){
+            unschedule(it->second);
+        }
+        state.particle_nodes.insert_or_assign(state.particles, par.id, par);
+        state.pending_updates->push_back(par.id);
+        if(is_resting(par)){
+            state.awake_nodes.release(state.awake, par.id);
+        }else{
+            state.awake_nodes.insert(state.awake, par.id);
+            schedule(par);
         }
     }
 
     typename cadmium::make_message_bags<output_ports>::type output() const {
         typename cadmium::make_message_bags<output_ports>::type bag;
 
-        for(auto move_msg : state.pending_moves){
-            cadmium::get_messages<typename volume_defs<TIME, REAL, DIMS>::particle_leaving>(bag).push_back(move_msg);
-        }
+        auto& leaving = cadmium::get_messages<typename volume_defs<TIME, REAL, DIMS>::particle_leaving>(bag);
+        leaving.insert(leaving.end(), state.pending_moves.begin(), state.pending_moves.end());
 
-        if(state.pending_moves.size() || state.pending_updates.size()){
-            cadmium::get_messages<typename volume_defs<TIME, REAL, DIMS>::particle_announcement>(bag).push_back({state.volume_id, state.pending_updates, state.pending_removals, &state.particles});
+        if(state.pending_moves.size() || state.pending_updates->size()){
+            cadmium::get_messages<typename volume_defs<TIME, REAL, DIMS>::particle_announcement>(bag).push_back({state.volume_id, &*state.pending_updates, &*state.pending_removals, &state.particles, &state.awake});
         }
 
         return bag;
 
     }
 
+    /*
+        Shuffles the particles between the map's nodes so that going through the map in id order goes up through memory.
+        A particle that comes in gets whichever spare node left last, so after enough comings and goings a walk over the map,
+        which is what every collider's pair loop is, jumps all over the heap. Ids are all anything keys on, and within a volume
+        every pair gets looked at anyway, so it is the order in memory that matters here, not the order in space.
+        No node is made or freed, and the map itself stays put, only pointers to particles in it go stale, nothing keeps one past a transition.
+    */
+    void relayout(){
+        using node_type = typename std::map<std::size_t, particle<TIME, REAL, DIMS>>::node_type;
+        std::vector<node_type> nodes{};
+        std::vector<particle<TIME, REAL, DIMS>> in_order{};
+        nodes.reserve(state.particles.size());
+        in_order.reserve(state.particles.size());
+        while(state.particles.size()){
+            nodes.push_back(state.particles.extract(state.particles.begin()));
+            in_order.push_back(nodes.back().mapped());
+        }
+        std::sort(nodes.begin(), nodes.end(), [](const node_type& lhs, const node_type& rhs){
+            return std::less<const void*>{}(&lhs.mapped(), &rhs.mapped());
+        });
+        for(size_t i = 0; i<nodes.size(); i++){
+            nodes[i].key() = in_order[i].id;
+            nodes[i].mapped() = in_order[i];
+            state.particles.insert(state.particles.end(), std::move(nodes[i]));
+        }
+        state.arrivals = 0;
+    }
+
     void internal_transition(){
         state.global_time += time_advance();
+        state.transitions++;
+        state.cleared_at = state.transitions;
 
-        //We just got here from the output function, we can clear the queued updates.
-        state.pending_updates.clear();
-        state.pending_removals.clear();
+        //We just got here from the output function, we can start on new updates, what went out is left on the other side.
+        state.pending_updates.flip();
+        state.pending_removals.flip();
         state.pending_moves.clear();
 
-        //set the next internal time to inf, we bring it down as we find particles that need internal transitions sooner
-        state.next_internal_time = std::numeric_limits<TIME>::infinity();
+        //only the particles with an event due now are looked at, in id order, the rest keep their place in state.due
+        state.due_now.clear();
+        while(state.due.size() && state.due.begin()->first <= state.global_time){
+            state.due_now.push_back(state.due.begin()->second);
+            state.due_nodes.release(state.due, *state.due.begin());
+        }
+        std::sort(state.due_now.begin(), state.due_now.end());
 
-        for(auto& kv : state.particles){
+        for(const auto k : state.due_now){
             // k -> key, v -> value, very creative
-            auto& k = kv.first;
-            auto& v = kv.second;
+            auto& v = state.particles.find(k)->second;
 
             // if the particle is leaving the volume right now, have it leave
-            // otherwise, if it has a deffered dv to apply right now, do so
-            // otherwise compare both the next time it would leave the volume and the next time it would have an deffered dv to the standing 'next_internal_time' and take the min
+            // otherwise it has a deffered dv to apply right now, so do so
             TIME next_move_out_time = move_out_time(v, state.one_corner, state.size);
             if(next_move_out_time <= state.global_time){
                 //put the patricle into the moving-out queue, and add it to the removal update queue
-                //we would remove it from state.particles here, but that would invalidate our iterator, so we wait until we finish first
-                state.pending_moves.push_back({move_out_destination(v, state.one_corner, state.size, state.volume_id), v});
-                state.pending_removals.push_back(k);
-            }else if(v.deferred_dv_time <= state.global_time){
+                //we would remove it from state.particles here, but we wait until we finish first, like the updates
+                auto destination_id = move_out_destination(v, state.one_corner, state.size, state.volume_id);
+                if(settings.periodic.any()){
+                    //it goes out as a copy, so it can be moved to the other side of the domain without touching the one we still hold
+                    auto moving = v;
+                    wrap_crossing(settings.periodic, moving, destination_id);
+                    add_to_moving_block(state.pending_moves, destination_id, moving);
+                }else{
+                    add_to_moving_block(state.pending_moves, destination_id, v);
+                }
+                state.pending_removals->push_back(k);
+            }else{
+                if(v.deferred_dv_time < state.global_time && settings.coalesce_tolerance > TIME{0}){
+                    //it was held back to share this transition, apply_dv still puts the dv in at the right time, but everyone else hears about it late
+                    state.coalesced.record_announced_late(v.mass, v.velocity, v.deferred_dv, state.global_time - v.deferred_dv_time);
+                }
                 //we simply calculate what the particle would look like after its dv is applied
                 //we could advance it to now, but the function alrady advances it to when the dv was going to be applied, so the diference should be negligable
                 v = apply_dv(v);
-                state.pending_updates.push_back(v.id);
-            }else{
-                // std::min takes only 2 arguments, not variadic arguments, so we need to place 2 calls to resolve the min of 3 elements
-                state.next_internal_time = std::min(state.next_internal_time, std::min(next_move_out_time, v.deferred_dv_time));
+                state.pending_updates->push_back(v.id);
+                if(is_resting(v)){
+                    //it has come to a stop, put it to sleep
+                    state.awake_nodes.release(state.awake, k);
+                }else{
+                    schedule(v);
+                }
             }
         }
+
+        //the soonest event left, or if coalescing, the last one due within the tolerance of it
+        state.next_internal_time = std::numeric_limits<TIME>::infinity();
+        if(state.due.size()){
+            state.next_internal_time = state.due.begin()->first;
+            if(settings.coalesce_tolerance > TIME{0}){
+                const TIME first = state.next_internal_time;
+                for(auto it = state.due.begin(); it != state.due.end() && it->first <= first+settings.coalesce_tolerance; it++){
+                    state.next_internal_time = it->first;
+                }
+            }
+        }
+
         //We remove all of the particles that move out of this volume here
-        for(size_t i : state.pending_removals){
-            state.particles.extract(i);
+        for(size_t i : *state.pending_removals){
+            state.particle_nodes.release(state.particles, i);
+            state.awake_nodes.release(state.awake, i);
         }
     }
 
     void external_transition(TIME dt, typename cadmium::make_message_bags<input_ports>::type mbs) {
         state.global_time += dt;
+        state.transitions++;
 
         for(const auto& move_msg : cadmium::get_messages<typename volume_defs<TIME, REAL, DIMS>::particle_entering>(mbs)){
-            //we take each moving particle who's destination is this volume and add it, and queue an update about it
+            //we take each block of moving particles who's destination is this volume and add them, and queue an update about each
             if(move_msg.destination_id == state.volume_id){
-                state.particles[move_msg.moving_particle.id] = move_msg.moving_particle;
-                state.pending_updates.push_back(move_msg.moving_particle.id);
+                for(const auto& moving_particle : move_msg){
+                    take(moving_particle);
+                    state.arrivals++;
+                }
             }
         }
 
         for(const auto& delta_msg : cadmium::get_messages<typename volume_defs<TIME, REAL, DIMS>::particle_delta>(mbs)){
             if(delta_msg.volume_id == state.volume_id){
-                if(state.particles.count(delta_msg.particle_id)){
+                auto par_it = state.particles.find(delta_msg.particle_id);
+                if(par_it != state.particles.end()){
                     //for each incoming delta message, if we have a particle with that id, we apply the delta and queue an update message about it
-                    auto& par = state.particles[delta_msg.particle_id];
+                    auto& par = par_it->second;
+                    unschedule(par);
                     par = apply_delta(advance_to_time(par, state.global_time), delta_msg);
-                    state.pending_updates.push_back(par.id);
+                    state.pending_updates->push_back(par.id);
+                    //this is what wakes up a resting particle, the delta leaves a deferred dv behind even if it stops it
+                    //one that it does leave resting goes to sleep, like it would coming in, or the colliders would keep looking at it
+                    if(is_resting(par)){
+                        state.awake_nodes.release(state.awake, par.id);
+                    }else{
+                        state.awake_nodes.insert(state.awake, par.id);
+                        schedule(par);
+                    }
                 }else{
-                    for(auto& pp : state.pending_moves){
-                        if(pp.moving_particle.id == delta_msg.particle_id){
-                            //it is possible for a delta to come in for a particle that is in the queue to leave this volume.
-                            //We do not want to miss deltas if we can avoid it, so we apply the delta here
-                            //There is no need to send an anouncement, as the volume that is going to get this particle is going to anounce it there
-                            pp.moving_particle = apply_delta(pp.moving_particle, delta_msg);
+                    for(auto& block : state.pending_moves){
+                        for(auto& pp : block){
+                            if(pp.id == delta_msg.particle_id){
+                                //it is possible for a delta to come in for a particle that is in the queue to leave this volume.
+                                //We do not want to miss deltas if we can avoid it, so we apply the delta here
+                                //There is no need to send an anouncement, as the volume that is going to get this particle is going to anounce it there
+                                pp = apply_delta(pp, delta_msg);
+                            }
                         }
                     }
                 }
             }
         }
+
+        if(settings.relayout_after && state.arrivals >= settings.relayout_after){
+            relayout();
+        }
     }
 
     void confluence_transition(TIME, typename cadmium::make_message_bags<input_ports>::type mbs) {
@@ -234,7 +457,7 @@ struct volume_model{
 
 
     TIME time_advance() const {
-        if(state.pending_moves.size() || state.pending_updates.size()){
+        if(state.pending_moves.size() || state.pending_updates->size()){
             return {0};
         }else{
             return std::max(state.next_internal_time-state.global_time, {0});
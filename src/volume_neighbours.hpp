@@ -0,0 +1,69 @@
+#ifndef __VOLUME_NEIGHBOURS_HPP__
+#define __VOLUME_NEIGHBOURS_HPP__
+
+#include <array>
+#include <cstddef>
+
+namespace tps{
+
+/*
+    calls f once for every volume id that shares at least one corner with volume_id, including volume_id itself
+    there are 3^DIMS of them, and they are visited in lexicographic order
+*/
+template<std::size_t DIMS, typename F>
+void for_each_neighbour(const std::array<long, DIMS>& volume_id, F&& f){
+    std::array<long, DIMS> offset;
+    offset.fill(-1);
+    while(true){
+        std::array<long, DIMS> neighbour = volume_id;
+        for(size_t i = 0; i<DIMS; i++){
+            neighbour[i] += offset[i];
+        }
+        f(neighbour);
+
+        //count up in base 3 from {-1, ..., -1} to {1, ..., 1}
+        size_t i = DIMS;
+        while(i > 0 && offset[i-1] == 1){
+            offset[i-1] = -1;
+            i--;
+        }
+        if(i == 0){
+            return;
+        }
+        offset[i-1]++;
+    }
+}
+
+/*
+    as above, but on each axis where wrap[i] is non zero the ids wrap around modulo wrap[i]
+    f gets the wrapped id, and how many times each axis wrapped to get there (-1, 0 or 1), which says which copy of that volume is the neighbour
+    on a wrapped axis with 2 volumes the other volume is a neighbour on both sides, so it is visited twice, once for each copy
+*/
+template<std::size_t DIMS, typename F>
+void for_each_neighbour(const std::array<long, DIMS>& volume_id, const std::array<long, DIMS>& wrap, F&& f){
+    for_each_neighbour(volume_id, [&](std::array<long, DIMS> neighbour){
+        std::array<long, DIMS> wraps{};
+        for(size_t i = 0; i<DIMS; i++){
+            if(wrap[i] && neighbour[i] < 0){
+                neighbour[i] += wrap[i];
+                wraps[i] = -1;
+            }else if(wrap[i] && neighbour[i] >= wrap[i]){
+                neighbour[i] -= wrap[i];
+                wraps[i] = 1;
+            }
+        }
+        f(neighbour, wraps);
+    });
+}
+
+template<std::size_t DIMS>
+bool is_neighbour(const std::array<long, DIMS>& lhs, const std::array<long, DIMS>& rhs){
+    bool good = true;
+    for(size_t i = 0; i<DIMS; i++){
+        good &= lhs[i] == rhs[i]+1 || lhs[i] == rhs[i] || lhs[i] == rhs[i]-1;
+    }
+    return good;
+}
+
+}
+#endif /* __VOLUME_NEIGHBOURS_HPP__ */
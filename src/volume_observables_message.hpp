@@ -0,0 +1,58 @@
+#ifndef __VOLUME_OBSERVABLES_MESSAGE_HPP__
+#define __VOLUME_OBSERVABLES_MESSAGE_HPP__
+
+#include <array>
+#include <ostream>
+
+#include "./log_filter.hpp"
+
+namespace tps{
+
+/*
+    What one volume looked like over one sampling window, units are whatever the particles use, with k_B = 1.
+    count, mass, momentum and temperature are taken at time, collisions and pressure are over the window that ends at time.
+*/
+template<typename TIME, typename REAL, std::size_t DIMS>
+struct volume_observables_message{
+    TIME time;
+    std::array<long, DIMS> volume_id;
+    std::size_t count;
+    REAL density;                               //count per unit of volume
+    REAL mass;
+    std::array<REAL, DIMS> momentum;
+    REAL temperature;                           //sum of m|v-v_cm|^2 / (DIMS*count)
+    std::size_t collisions;                     //collisions with a particle of this volume, a collision inside the volume counts twice
+    REAL pressure;                              //kinetic part plus the collision virial
+};
+
+template<typename TIME, typename REAL, std::size_t DIMS>
+std::ostream& operator<<(std::ostream& os, const volume_observables_message<TIME, REAL, DIMS>& msg) {
+    const auto& view = current_log_view();
+    const auto& filter = view.rules();
+    if(!view.open || !filter.observables || !filter.volume(msg.volume_id)){
+        return os;
+    }
+
+    os << "[" << msg.time << ", [";
+
+    for(size_t i = 0; i<DIMS; i++){
+        if(i){
+            os << ", ";
+        }
+        os << msg.volume_id[i];
+    }
+
+    os << "], " << msg.count << ", " << msg.density << ", " << msg.mass << ", [";
+
+    for(size_t i = 0; i<DIMS; i++){
+        if(i){
+            os << ", ";
+        }
+        os << msg.momentum[i];
+    }
+
+    return os << "], " << msg.temperature << ", " << msg.collisions << ", " << msg.pressure << "]";
+}
+
+}
+#endif /* __VOLUME_OBSERVABLES_MESSAGE_HPP__ */
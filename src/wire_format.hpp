@@ -0,0 +1,191 @@
+#ifndef __WIRE_FORMAT_HPP__
+#define __WIRE_FORMAT_HPP__
+
+#include <cstddef>
+#include <cstring>
+#include <array>
+#include <vector>
+#include <map>
+#include <limits>
+#include <stdexcept>
+#include <type_traits>
+
+#include "./particle.hpp"
+#include "./particle_moving_message.hpp"
+#include "./particle_delta_message.hpp"
+
+namespace tps{
+
+/*
+    A flat byte format for sending messages between processes on the same host.
+    Values go in host byte order, both ends are expected to be the same build on the same machine.
+    Every record starts with a one byte wire_record tag so a reader can tell what comes next.
+*/
+enum class wire_record : char{
+    moving = 'M',
+    delta = 'D',
+    volume = 'V',
+};
+
+struct wire_writer{
+    std::vector<char>& buffer;
+
+    template<typename T>
+    void put(const T& value){
+        static_assert(std::is_trivially_copyable<T>::value, "only trivially copyable values can go on the wire");
+        const std::size_t at = buffer.size();
+        buffer.resize(at+sizeof(T));
+        std::memcpy(buffer.data()+at, &value, sizeof(T));
+    }
+};
+
+struct wire_reader{
+    const std::vector<char>& buffer;
+    std::size_t at{0};
+
+    template<typename T>
+    T get(){
+        static_assert(std::is_trivially_copyable<T>::value, "only trivially copyable values can come off the wire");
+        if(at+sizeof(T) > buffer.size()){
+            throw std::out_of_range("wire_reader ran off the end of its buffer");
+        }
+        T value;
+        std::memcpy(&value, buffer.data()+at, sizeof(T));
+        at += sizeof(T);
+        return value;
+    }
+
+    bool done() const {
+        return at >= buffer.size();
+    }
+};
+
+/*
+    a particle with no deferred dv leaves out the deferred fields, which is most of them
+*/
+template<typename TIME, typename REAL, std::size_t DIMS>
+void write_particle(wire_writer& out, const particle<TIME, REAL, DIMS>& par){
+    out.put(par.last_updated);
+    out.put(par.id);
+    out.put(par.species);
+    out.put(par.mass);
+    out.put(par.radius);
+    out.put(par.position);
+    out.put(par.velocity);
+    const bool deferred = par.deferred_dv_time != std::numeric_limits<TIME>::infinity();
+    out.put(deferred);
+    if(deferred){
+        out.put(par.deferred_dv);
+        out.put(par.deferred_dv_time);
+        out.put(par.hits_since_last_deferred_dv_clear);
+    }
+}
+
+template<typename TIME, typename REAL, std::size_t DIMS>
+particle<TIME, REAL, DIMS> read_particle(wire_reader& in){
+    particle<TIME, REAL, DIMS> par{};
+    par.last_updated = in.get<TIME>();
+    par.id = in.get<std::size_t>();
+    par.species = in.get<std::size_t>();
+    par.mass = in.get<REAL>();
+    par.radius = in.get<REAL>();
+    par.position = in.get<std::array<REAL, DIMS>>();
+    par.velocity = in.get<std::array<REAL, DIMS>>();
+    par.deferred_dv = {};
+    par.deferred_dv_time = std::numeric_limits<TIME>::infinity();
+    par.hits_since_last_deferred_dv_clear = 0;
+    if(in.get<bool>()){
+        par.deferred_dv = in.get<std::array<REAL, DIMS>>();
+        par.deferred_dv_time = in.get<TIME>();
+        par.hits_since_last_deferred_dv_clear = in.get<std::size_t>();
+    }
+    return par;
+}
+
+template<typename TIME, typename REAL, std::size_t DIMS>
+void write_message(wire_writer& out, const particle_moving_message<TIME, REAL, DIMS>& msg){
+    out.put(wire_record::moving);
+    out.put(msg.destination_id);
+    out.put(msg.size());
+    for(const auto& par : msg){
+        write_particle(out, par);
+    }
+}
+
+template<typename TIME, typename REAL, std::size_t DIMS>
+particle_moving_message<TIME, REAL, DIMS> read_moving_message(wire_reader& in){
+    particle_moving_message<TIME, REAL, DIMS> msg{};
+    msg.destination_id = in.get<std::array<long, DIMS>>();
+    const std::size_t count = in.get<std::size_t>();
+    for(std::size_t i = 0; i<count; i++){
+        msg.moving_particles.push_back(read_particle<TIME, REAL, DIMS>(in));
+    }
+    return msg;
+}
+
+template<typename TIME, typename REAL, std::size_t DIMS>
+void write_message(wire_writer& out, const particle_delta_message<TIME, REAL, DIMS>& msg){
+    out.put(wire_record::delta);
+    out.put(msg);
+}
+
+template<typename TIME, typename REAL, std::size_t DIMS>
+particle_delta_message<TIME, REAL, DIMS> read_delta_message(wire_reader& in){
+    return in.get<particle_delta_message<TIME, REAL, DIMS>>();
+}
+
+template<typename TIME, typename REAL, std::size_t DIMS>
+bool same_particle(const particle<TIME, REAL, DIMS>& lhs, const particle<TIME, REAL, DIMS>& rhs){
+    return lhs.last_updated == rhs.last_updated && lhs.id == rhs.id && lhs.species == rhs.species
+        && lhs.mass == rhs.mass && lhs.radius == rhs.radius && lhs.position == rhs.position && lhs.velocity == rhs.velocity
+        && lhs.deferred_dv == rhs.deferred_dv && lhs.deferred_dv_time == rhs.deferred_dv_time
+        && lhs.hits_since_last_deferred_dv_clear == rhs.hits_since_last_deferred_dv_clear;
+}
+
+/*
+    Announcements point at live volume state, which can not cross a process boundary, so volumes are sent as the difference
+    between what they hold now and what was last sent for them. sent is brought up to date as a side effect.
+*/
+template<typename TIME, typename REAL, std::size_t DIMS>
+void write_volume_update(wire_writer& out, const std::array<long, DIMS>& volume_id, const std::map<std::size_t, particle<TIME, REAL, DIMS>>& now, std::map<std::size_t, particle<TIME, REAL, DIMS>>& sent){
+    std::vector<const particle<TIME, REAL, DIMS>*> changed{};
+    std::vector<std::size_t> removed{};
+
+    auto now_it = now.begin();
+    auto sent_it = sent.begin();
+    while(now_it != now.end() || sent_it != sent.end()){
+        if(sent_it == sent.end() || (now_it != now.end() && now_it->first < sent_it->first)){
+            changed.push_back(&now_it->second);
+            now_it++;
+        }else if(now_it == now.end() || sent_it->first < now_it->first){
+            removed.push_back(sent_it->first);
+            sent_it++;
+        }else{
+            if(!same_particle(now_it->second, sent_it->second)){
+                changed.push_back(&now_it->second);
+            }
+            now_it++;
+            sent_it++;
+        }
+    }
+
+    if(changed.empty() && removed.empty()){
+        return;
+    }
+
+    out.put(wire_record::volume);
+    out.put(volume_id);
+    out.put(changed.size());
+    for(const auto* par : changed){
+        write_particle(out, *par);
+    }
+    out.put(removed.size());
+    for(const auto id : removed){
+        out.put(id);
+    }
+
+    sent = now;
+}
+
+}
+#endif /* __WIRE_FORMAT_HPP__ */
@@ -8,6 +8,7 @@
 
 #include "./../src/particle.hpp"
 #include "./../src/volume_model.hpp"
+#include "./../src/async_log_sink.hpp"
 
 #include <iostream>
 #include <chrono>
@@ -74,13 +75,13 @@ int main(int argc, char ** argv) {
     );
 
     /*** Loggers ***/
-    static std::ofstream out_messages("./simulation_results/output_messages.txt");
+    static async_log_sink out_messages("./simulation_results/output_messages.txt");
     struct oss_sink_messages{
         static std::ostream& sink(){
             return out_messages;
         }
     };
-    static std::ofstream out_state("./simulation_results/output_state.txt");
+    static async_log_sink out_state("./simulation_results/output_state.txt");
     struct oss_sink_state{
         static std::ostream& sink(){
             return out_state;
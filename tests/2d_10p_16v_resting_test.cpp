@@ -0,0 +1,99 @@
+
+//Cadmium Simulator headers
+#include <cadmium/modeling/ports.hpp>
+#include <cadmium/modeling/dynamic_model.hpp>
+#include <cadmium/modeling/dynamic_model_translator.hpp>
+#include <cadmium/engine/pdevs_dynamic_runner.hpp>
+#include <cadmium/logger/common_loggers.hpp>
+
+
+#include "./../src/blocking_collider_model.hpp"
+#include "./../src/particle.hpp"
+#include "./../src/volume_model.hpp"
+#include "./../src/grid_topology.hpp"
+#include "./../src/async_log_sink.hpp"
+
+#include <iostream>
+#include <chrono>
+#include <algorithm>
+#include <string>
+#include <fstream>
+
+
+/***** Define input port for coupled models *****/
+
+/***** Define input port for coupled models *****/
+
+using namespace cadmium;
+using namespace tps;
+
+using TIME = double;
+using REAL = double;
+
+template<typename TT>
+using particle_2d = particle<TT, REAL, 2>;
+
+int main(int argc, char ** argv) {
+    // the particles get inited in order like this [last_updated, id, species, mass, radius, [position], [velocity], [deferred_dv], deferred_dv_time]
+
+    // a 4x4 grid of 10x10 volumes, most of the particles start out resting
+    // 1 runs into a row of 3 resting particles and stops, which knocks the last one in the row on, newtons cradle style
+    // 5 to 10 are a resting pile that nothing ever reaches, they should never be looked at again after the first scan
+    auto grid = make_sharded_grid<TIME, REAL, 2>(
+        {4, 4}, {0.0, 0.0}, {10.0, 10.0}, {4, 4},
+        std::vector<particle_2d<TIME>>{
+            {{0}, {1}, {0}, {1}, {1}, { 0.0, 5}, { 1,  0}, {0}, {std::numeric_limits<TIME>::infinity()}},
+            {{0}, {2}, {0}, {1}, {1}, {10.0, 5}, { 0,  0}, {0}, {std::numeric_limits<TIME>::infinity()}},
+            {{0}, {3}, {0}, {1}, {1}, {12.5, 5}, { 0,  0}, {0}, {std::numeric_limits<TIME>::infinity()}},
+            {{0}, {4}, {0}, {1}, {1}, {15.0, 5}, { 0,  0}, {0}, {std::numeric_limits<TIME>::infinity()}},
+
+            {{0}, { 5}, {0}, {1}, {1}, {22, 32}, {0, 0}, {0}, {std::numeric_limits<TIME>::infinity()}},
+            {{0}, { 6}, {0}, {1}, {1}, {24, 32}, {0, 0}, {0}, {std::numeric_limits<TIME>::infinity()}},
+            {{0}, { 7}, {0}, {1}, {1}, {26, 32}, {0, 0}, {0}, {std::numeric_limits<TIME>::infinity()}},
+            {{0}, { 8}, {0}, {1}, {1}, {23, 34}, {0, 0}, {0}, {std::numeric_limits<TIME>::infinity()}},
+            {{0}, { 9}, {0}, {1}, {1}, {25, 34}, {0, 0}, {0}, {std::numeric_limits<TIME>::infinity()}},
+            {{0}, {10}, {0}, {1}, {1}, {24, 36}, {0, 0}, {0}, {std::numeric_limits<TIME>::infinity()}},
+        });
+
+
+    dynamic::modeling::Ports iports_TOP{};
+    dynamic::modeling::Ports oports_TOP{};
+    dynamic::modeling::Models submodels_TOP = grid.models;
+    dynamic::modeling::EICs eics_TOP{};
+    dynamic::modeling::EOCs eocs_TOP{};
+    dynamic::modeling::ICs ics_TOP = grid.ics;
+
+    std::shared_ptr<dynamic::modeling::coupled<TIME>> TOP = std::make_shared<dynamic::modeling::coupled<TIME>>(
+        "TOP", submodels_TOP, iports_TOP, oports_TOP, eics_TOP, eocs_TOP, ics_TOP
+    );
+
+    /*** Loggers ***/
+    static async_log_sink out_messages("./simulation_results/output_messages.txt");
+    struct oss_sink_messages{
+        static std::ostream& sink(){
+            return out_messages;
+        }
+    };
+    static async_log_sink out_state("./simulation_results/output_state.txt");
+    struct oss_sink_state{
+        static std::ostream& sink(){
+            return out_state;
+        }
+    };
+
+    using state=logger::logger<logger::logger_state, dynamic::logger::formatter<TIME>, oss_sink_state>;
+    using log_messages=logger::logger<logger::logger_messages, dynamic::logger::formatter<TIME>, oss_sink_messages>;
+    using global_time_mes=logger::logger<logger::logger_global_time, dynamic::logger::formatter<TIME>, oss_sink_messages>;
+    using global_time_sta=logger::logger<logger::logger_global_time, dynamic::logger::formatter<TIME>, oss_sink_state>;
+
+    using logger_top=logger::multilogger<state, log_messages, global_time_mes, global_time_sta>;
+
+    /*** Runner call ***/
+    dynamic::engine::runner<TIME, logger_top> r(TOP, {0});
+    //r.run_until(NDTime("00:05:00:000"));
+    std::cout << "Starting it up!\n";
+    r.run_until(TIME{30});
+    std::cout << "Wrapping it up!\n";
+    return 0;
+
+}
@@ -0,0 +1,105 @@
+
+//Cadmium Simulator headers
+#include <cadmium/modeling/ports.hpp>
+#include <cadmium/modeling/dynamic_model.hpp>
+#include <cadmium/modeling/dynamic_model_translator.hpp>
+#include <cadmium/engine/pdevs_dynamic_runner.hpp>
+#include <cadmium/logger/common_loggers.hpp>
+
+
+#include "./../src/blocking_collider_model.hpp"
+#include "./../src/particle.hpp"
+#include "./../src/volume_model.hpp"
+#include "./../src/grid_topology.hpp"
+#include "./../src/async_log_sink.hpp"
+
+#include <iostream>
+#include <chrono>
+#include <algorithm>
+#include <string>
+#include <fstream>
+
+
+/***** Define input port for coupled models *****/
+
+/***** Define input port for coupled models *****/
+
+using namespace cadmium;
+using namespace tps;
+
+using TIME = double;
+using REAL = double;
+
+template<typename TT>
+using particle_2d = particle<TT, REAL, 2>;
+
+int main(int argc, char ** argv) {
+    // the particles get inited in order like this [last_updated, id, species, mass, radius, [position], [velocity], [deferred_dv], deferred_dv_time]
+
+    // a channel 4 volumes long, with closed edges so particles can leave it
+    // the source puts a particle in at the left end every 1 time unit, 20 of them, and the sink counts them leaving at the right end
+    // they all move the same way at the same speed so they never hit, the source has to skip a turn when the last one has not cleared its box yet
+    // 1 is there from the start, it leaves first
+    auto grid = make_sharded_grid<TIME, REAL, 2>(
+        {4, 1}, {0.0, 0.0}, {10.0, 10.0}, {4, 1},
+        std::vector<particle_2d<TIME>>{
+            {{0}, {1}, {0}, {1}, {1}, {30, 5}, {2, 0}, {0}, {std::numeric_limits<TIME>::infinity()}},
+        },
+        false);
+
+    typename particle_source_model<TIME, REAL, 2>::settings_type inflow{};
+    inflow.volume_id = {0, 0};
+    inflow.corner = {1, 1};
+    inflow.size = {2, 8};
+    inflow.velocity_mean = {2, 0};
+        inflow.limit = 20;
+    inflow.first_id = 1000;
+    inflow.seed = 7;
+    add_source<TIME, REAL, 2>(grid, inflow);
+
+    typename particle_sink_model<TIME, REAL, 2>::settings_type outflow{};
+    outflow.outlets = {{4, 0}};
+    add_sink<TIME, REAL, 2>(grid, outflow);
+
+
+    dynamic::modeling::Ports iports_TOP{};
+    dynamic::modeling::Ports oports_TOP{};
+    dynamic::modeling::Models submodels_TOP = grid.models;
+    dynamic::modeling::EICs eics_TOP{};
+    dynamic::modeling::EOCs eocs_TOP{};
+    dynamic::modeling::ICs ics_TOP = grid.ics;
+
+    std::shared_ptr<dynamic::modeling::coupled<TIME>> TOP = std::make_shared<dynamic::modeling::coupled<TIME>>(
+        "TOP", submodels_TOP, iports_TOP, oports_TOP, eics_TOP, eocs_TOP, ics_TOP
+    );
+
+    /*** Loggers ***/
+    static async_log_sink out_messages("./simulation_results/output_messages.txt");
+    struct oss_sink_messages{
+        static std::ostream& sink(){
+            return out_messages;
+        }
+    };
+    static async_log_sink out_state("./simulation_results/output_state.txt");
+    struct oss_sink_state{
+        static std::ostream& sink(){
+            return out_state;
+        }
+    };
+
+    using state=logger::logger<logger::logger_state, dynamic::logger::formatter<TIME>, oss_sink_state>;
+    using log_messages=logger::logger<logger::logger_messages, dynamic::logger::formatter<TIME>, oss_sink_messages>;
+    using global_time_mes=logger::logger<logger::logger_global_time, dynamic::logger::formatter<TIME>, oss_sink_messages>;
+    using global_time_sta=logger::logger<logger::logger_global_time, dynamic::logger::formatter<TIME>, oss_sink_state>;
+
+    using logger_top=logger::multilogger<state, log_messages, global_time_mes, global_time_sta>;
+
+    /*** Runner call ***/
+    dynamic::engine::runner<TIME, logger_top> r(TOP, {0});
+    //r.run_until(NDTime("00:05:00:000"));
+    std::cout << "Starting it up!\n";
+    r.run_until(TIME{40});
+    std::cout << "Wrapping it up!\n";
+    return 0;
+
+}
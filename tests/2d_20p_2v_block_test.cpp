@@ -0,0 +1,95 @@
+//Cadmium Simulator headers
+#include <cadmium/modeling/ports.hpp>
+#include <cadmium/modeling/dynamic_model.hpp>
+#include <cadmium/modeling/dynamic_model_translator.hpp>
+#include <cadmium/engine/pdevs_dynamic_runner.hpp>
+#include <cadmium/logger/common_loggers.hpp>
+
+
+#include "./../src/particle.hpp"
+#include "./../src/volume_model.hpp"
+#include "./../src/async_log_sink.hpp"
+
+#include <iostream>
+#include <chrono>
+#include <algorithm>
+#include <string>
+#include <fstream>
+
+
+/***** Define input port for coupled models *****/
+
+/***** Define input port for coupled models *****/
+
+using namespace cadmium;
+using namespace tps;
+
+using TIME = double;
+using REAL = double;
+
+template<typename TT>
+using volume_model_2d = volume_model<TT, REAL, 2>;
+
+template<typename TT>
+using particle_2d = particle<TT, REAL, 2>;
+
+int main(int argc, char ** argv) {
+    // the particles get inited in order like this [last_updated, id, species, mass, radius, [position], [velocity], [deferred_dv], deferred_dv_time]
+
+    // 20 particles in a column, all crossing into vol_1 at 1, which is more than a move message used to hold
+    // they all have to go over in the one block, in id order, and none may be dropped
+    std::vector<particle_2d<TIME>> column{};
+    for(std::size_t i = 0; i<20; i++){
+        column.push_back({{0}, {i+1}, {0}, {1}, {0.5}, {9, 2.0*i}, {1, 0}, {0}, {std::numeric_limits<TIME>::infinity()}});
+    }
+    std::shared_ptr<dynamic::modeling::model> vol_0 = dynamic::translate::make_dynamic_atomic_model<volume_model_2d, TIME>(
+        "vol_0", std::array<long, 2>{0, 0}, std::array<REAL, 2>{0.0, -100.0}, std::array<REAL, 2>{10.0, std::numeric_limits<REAL>::infinity()}, column);
+    std::shared_ptr<dynamic::modeling::model> vol_1 = dynamic::translate::make_dynamic_atomic_model<volume_model_2d, TIME>(
+        "vol_1", std::array<long, 2>{1, 0}, std::array<REAL, 2>{10.0, -100.0}, std::array<REAL, 2>{std::numeric_limits<REAL>::infinity(), std::numeric_limits<REAL>::infinity()});
+
+
+    dynamic::modeling::Ports iports_TOP{};
+    dynamic::modeling::Ports oports_TOP{};
+    dynamic::modeling::Models submodels_TOP{vol_0, vol_1};
+    dynamic::modeling::EICs eics_TOP{};
+    dynamic::modeling::EOCs eocs_TOP{};
+    dynamic::modeling::ICs ics_TOP{
+        dynamic::translate::make_IC<volume_defs<TIME, REAL, 2>::particle_leaving, volume_defs<TIME, REAL, 2>::particle_entering>("vol_0", "vol_1"),
+        dynamic::translate::make_IC<volume_defs<TIME, REAL, 2>::particle_leaving, volume_defs<TIME, REAL, 2>::particle_entering>("vol_1", "vol_0")
+    };
+
+    std::shared_ptr<dynamic::modeling::coupled<TIME>> TOP = std::make_shared<dynamic::modeling::coupled<TIME>>(
+        "TOP", submodels_TOP, iports_TOP, oports_TOP, eics_TOP, eocs_TOP, ics_TOP
+    );
+
+    /*** Loggers ***/
+    static async_log_sink out_messages("./simulation_results/output_messages.txt");
+    struct oss_sink_messages{
+        static std::ostream& sink(){
+            return out_messages;
+        }
+    };
+    static async_log_sink out_state("./simulation_results/output_state.txt");
+    struct oss_sink_state{
+        static std::ostream& sink(){
+            return out_state;
+        }
+    };
+
+    using state=logger::logger<logger::logger_state, dynamic::logger::formatter<TIME>, oss_sink_state>;
+    using log_messages=logger::logger<logger::logger_messages, dynamic::logger::formatter<TIME>, oss_sink_messages>;
+    using global_time_mes=logger::logger<logger::logger_global_time, dynamic::logger::formatter<TIME>, oss_sink_messages>;
+    using global_time_sta=logger::logger<logger::logger_global_time, dynamic::logger::formatter<TIME>, oss_sink_state>;
+
+    using logger_top=logger::multilogger<state, log_messages, global_time_mes, global_time_sta>;
+
+    /*** Runner call ***/
+    dynamic::engine::runner<TIME, logger_top> r(TOP, {0});
+    //r.run_until(NDTime("00:05:00:000"));
+    std::cout << "Starting it up!\n";
+    r.run_until(TIME{5});
+    std::cout << "Wrapping it up!\n";
+    return 0;
+
+}
+
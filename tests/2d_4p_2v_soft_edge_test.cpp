@@ -0,0 +1,99 @@
+
+//Cadmium Simulator headers
+#include <cadmium/modeling/ports.hpp>
+#include <cadmium/modeling/dynamic_model.hpp>
+#include <cadmium/modeling/dynamic_model_translator.hpp>
+#include <cadmium/engine/pdevs_dynamic_runner.hpp>
+#include <cadmium/logger/common_loggers.hpp>
+
+
+#include "./../src/blocking_collider_model.hpp"
+#include "./../src/particle.hpp"
+#include "./../src/volume_model.hpp"
+#include "./../src/grid_topology.hpp"
+#include "./../src/async_log_sink.hpp"
+
+#include <iostream>
+#include <chrono>
+#include <algorithm>
+#include <string>
+#include <fstream>
+
+
+/***** Define input port for coupled models *****/
+
+/***** Define input port for coupled models *****/
+
+using namespace cadmium;
+using namespace tps;
+
+using TIME = double;
+using REAL = double;
+
+template<typename TT>
+using particle_2d = particle<TT, REAL, 2>;
+
+int main(int argc, char ** argv) {
+    // the particles get inited in order like this [last_updated, id, species, mass, radius, [position], [velocity], [deferred_dv], deferred_dv_time]
+
+    // the soft contact pile from 2d_3p_1v_soft_contact_test, right up against the face between two long volumes
+    // 1 and 3 close in on 2 until the soft contact collider takes vol_0_0 over at 3, and gives it back a little after
+    // 4 comes at 2 from vol_1_0 at 1000, while the pile is taken, and reaches it at 3.05 still in vol_1_0, which is never taken over
+    // the pair has to stay with the blocking collider, 4 hits 2 at 1.5 and stops, a spring would only slow it down a step at a time
+    // and 4 would go right through the pile
+    auto grid = make_sharded_grid<TIME, REAL, 2>(
+        {2, 1}, {-5000.0, -10.0}, {5000.0, 20.0}, {2, 1},
+        std::vector<particle_2d<TIME>>{
+            {{0}, {1}, {0}, {100}, {1}, {  -0.5, -5}, {    0,  1}, {0}, {std::numeric_limits<TIME>::infinity()}},
+            {{0}, {2}, {0},   {1}, {1}, {  -0.5,  0}, {    0,  0}, {0}, {std::numeric_limits<TIME>::infinity()}},
+            {{0}, {3}, {0}, {100}, {1}, {  -0.5,  5}, {    0, -1}, {0}, {std::numeric_limits<TIME>::infinity()}},
+            {{0}, {4}, {0},   {1}, {1}, {3051.5,  0}, {-1000,  0}, {0}, {std::numeric_limits<TIME>::infinity()}},
+        });
+
+    soft_contact_model<TIME, REAL, 2>::settings_type soft_settings{};
+    soft_settings.handoff_hits = 20;
+    soft_settings.stiffness = 1e5;
+    add_soft_contact(grid, soft_settings);
+
+
+    dynamic::modeling::Ports iports_TOP{};
+    dynamic::modeling::Ports oports_TOP{};
+    dynamic::modeling::Models submodels_TOP = grid.models;
+    dynamic::modeling::EICs eics_TOP{};
+    dynamic::modeling::EOCs eocs_TOP{};
+    dynamic::modeling::ICs ics_TOP = grid.ics;
+
+    std::shared_ptr<dynamic::modeling::coupled<TIME>> TOP = std::make_shared<dynamic::modeling::coupled<TIME>>(
+        "TOP", submodels_TOP, iports_TOP, oports_TOP, eics_TOP, eocs_TOP, ics_TOP
+    );
+
+    /*** Loggers ***/
+    static async_log_sink out_messages("./simulation_results/output_messages.txt");
+    struct oss_sink_messages{
+        static std::ostream& sink(){
+            return out_messages;
+        }
+    };
+    static async_log_sink out_state("./simulation_results/output_state.txt");
+    struct oss_sink_state{
+        static std::ostream& sink(){
+            return out_state;
+        }
+    };
+
+    using state=logger::logger<logger::logger_state, dynamic::logger::formatter<TIME>, oss_sink_state>;
+    using log_messages=logger::logger<logger::logger_messages, dynamic::logger::formatter<TIME>, oss_sink_messages>;
+    using global_time_mes=logger::logger<logger::logger_global_time, dynamic::logger::formatter<TIME>, oss_sink_messages>;
+    using global_time_sta=logger::logger<logger::logger_global_time, dynamic::logger::formatter<TIME>, oss_sink_state>;
+
+    using logger_top=logger::multilogger<state, log_messages, global_time_mes, global_time_sta>;
+
+    /*** Runner call ***/
+    dynamic::engine::runner<TIME, logger_top> r(TOP, {0});
+    //r.run_until(NDTime("00:05:00:000"));
+    std::cout << "Starting it up!\n";
+    r.run_until(TIME{6});
+    std::cout << "Wrapping it up!\n";
+    return 0;
+
+}
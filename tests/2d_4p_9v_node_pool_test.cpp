@@ -0,0 +1,97 @@
+//Cadmium Simulator headers
+#include <cadmium/modeling/ports.hpp>
+#include <cadmium/modeling/dynamic_model.hpp>
+#include <cadmium/modeling/dynamic_model_translator.hpp>
+#include <cadmium/engine/pdevs_dynamic_runner.hpp>
+#include <cadmium/logger/common_loggers.hpp>
+
+
+#include "./../src/blocking_collider_model.hpp"
+#include "./../src/particle.hpp"
+#include "./../src/volume_model.hpp"
+#include "./../src/grid_topology.hpp"
+
+#include <iostream>
+#include <memory>
+#include <algorithm>
+#include <string>
+
+
+/***** Define input port for coupled models *****/
+
+/***** Define input port for coupled models *****/
+
+using namespace cadmium;
+using namespace tps;
+
+using TIME = double;
+using REAL = double;
+
+template<typename TT>
+using particle_2d = particle<TT, REAL, 2>;
+
+template<typename TT>
+using volume_model_2d = volume_model<TT, REAL, 2>;
+
+template<typename TT>
+using collider_model_2d = blocking_collider_model<TT, REAL, 2>;
+
+int main(int argc, char ** argv) {
+    // the particles get inited in order like this [last_updated, id, species, mass, radius, [position], [velocity], [deferred_dv], deferred_dv_time]
+
+    // the periodic grid of 2d_4p_9v_periodic_test, run for long enough that every particle has been through every volume on its path a few times
+    // every 10, how many nodes the volumes' and colliders' pools have made and reused so far, and how much room the volumes' announced id lists have
+    // once the particles have been all the way around, nothing goes to the heap any more, the made nodes and the room stop growing and only the reuses go up
+    grid_settings<TIME, REAL, 2> settings{};
+    settings.periodic = {true, true};
+    auto grid = make_sharded_grid<TIME, REAL, 2>(
+        {3, 3}, {0.0, 0.0}, {10.0, 10.0}, {3, 3},
+        std::vector<particle_2d<TIME>>{
+            {{0}, {1}, {0}, {1}, {1}, {27, 15}, { 1,  0}, {0}, {std::numeric_limits<TIME>::infinity()}},
+            {{0}, {2}, {0}, {1}, {1}, { 3, 15}, {-1,  0}, {0}, {std::numeric_limits<TIME>::infinity()}},
+
+            {{0}, {3}, {0}, {1}, {1}, { 5,  4}, { 0, -1}, {0}, {std::numeric_limits<TIME>::infinity()}},
+            {{0}, {4}, {0}, {1}, {1}, { 5, 26}, { 0,  1}, {0}, {std::numeric_limits<TIME>::infinity()}},
+        },
+        false, settings);
+
+
+    dynamic::modeling::Ports iports_TOP{};
+    dynamic::modeling::Ports oports_TOP{};
+    dynamic::modeling::Models submodels_TOP = grid.models;
+    dynamic::modeling::EICs eics_TOP{};
+    dynamic::modeling::EOCs eocs_TOP{};
+    dynamic::modeling::ICs ics_TOP = grid.ics;
+
+    std::shared_ptr<dynamic::modeling::coupled<TIME>> TOP = std::make_shared<dynamic::modeling::coupled<TIME>>(
+        "TOP", submodels_TOP, iports_TOP, oports_TOP, eics_TOP, eocs_TOP, ics_TOP
+    );
+
+    /*** Runner call ***/
+    dynamic::engine::runner<TIME, logger::not_logger> r(TOP, {0});
+    std::cout << "Starting it up!\n";
+    for(TIME t = 10; t <= 120; t += 10){
+        r.run_until(t);
+
+        std::size_t allocations = 0;
+        std::size_t reuses = 0;
+        std::size_t id_room = 0;
+        for(const auto& m : grid.models){
+            if(auto vol = std::dynamic_pointer_cast<volume_model_2d<TIME>>(m)){
+                const auto& state = vol->state;
+                allocations += state.particle_nodes.allocations + state.awake_nodes.allocations + state.due_nodes.allocations;
+                reuses += state.particle_nodes.reuses + state.awake_nodes.reuses + state.due_nodes.reuses;
+                for(std::size_t i = 0; i<2; i++){
+                    id_room += state.pending_updates.sides[i].capacity() + state.pending_removals.sides[i].capacity();
+                }
+            }else if(auto col = std::dynamic_pointer_cast<collider_model_2d<TIME>>(m)){
+                allocations += col->state.hit_nodes.allocations;
+                reuses += col->state.hit_nodes.reuses;
+            }
+        }
+        std::cout << t << " " << allocations << " " << reuses << " " << id_room << "\n";
+    }
+    std::cout << "Wrapping it up!\n";
+    return 0;
+
+}
@@ -0,0 +1,113 @@
+
+//Cadmium Simulator headers
+#include <cadmium/modeling/ports.hpp>
+#include <cadmium/modeling/dynamic_model.hpp>
+#include <cadmium/modeling/dynamic_model_translator.hpp>
+#include <cadmium/engine/pdevs_dynamic_runner.hpp>
+#include <cadmium/logger/common_loggers.hpp>
+
+
+#include "./../src/blocking_collider_model.hpp"
+#include "./../src/particle.hpp"
+#include "./../src/volume_model.hpp"
+#include "./../src/grid_topology.hpp"
+#include "./../src/async_log_sink.hpp"
+
+#include <iostream>
+#include <chrono>
+#include <algorithm>
+#include <string>
+#include <fstream>
+#include <memory>
+#include <stdexcept>
+
+
+/***** Define input port for coupled models *****/
+
+/***** Define input port for coupled models *****/
+
+using namespace cadmium;
+using namespace tps;
+
+using TIME = double;
+using REAL = double;
+
+template<typename TT>
+using particle_2d = particle<TT, REAL, 2>;
+
+int main(int argc, char ** argv) {
+    // the particles get inited in order like this [last_updated, id, species, mass, radius, [position], [velocity], [deferred_dv], deferred_dv_time]
+
+    // the sparse grid again, with resting volumes spilled out of memory into a file under simulation_results
+    // 1 and 2 rest in volume [5, 0] and 3 rests far off in [-4, -4], so both are spilled once they have announced themselves
+    // 4 rolls to the right from the start, and as it crosses into [4, 0] at t=20 volume [5, 0] is read back in
+    // 4 stops against 1 at t=23, 1 stops against 2 at t=24, and once 2 has rolled out past [6, 0] at t=30.5 the resting 4 and 1 are spilled again
+    typename sparse_grid_model<TIME, REAL, 2>::settings_type space{};
+    space.corner = {0.0, 0.0};
+    space.volume_size = {10.0, 10.0};
+    space.low = {-5, -5};
+    space.high = {9, 9};
+    space.spill_path = "./simulation_results";
+    auto grid = make_sparse_grid<TIME, REAL, 2>(
+        space,
+        std::vector<particle_2d<TIME>>{
+            {{0}, {1}, {0}, {1}, {1}, { 53,   5}, { 0,    0}, {0}, {std::numeric_limits<TIME>::infinity()}},
+            {{0}, {2}, {0}, {1}, {1}, { 57,   5}, { 0,    0}, {0}, {std::numeric_limits<TIME>::infinity()}},
+            {{0}, {3}, {0}, {1}, {1}, {-35, -35}, { 0,    0}, {0}, {std::numeric_limits<TIME>::infinity()}},
+            {{0}, {4}, {0}, {1}, {1}, {  5,   5}, { 2,    0}, {0}, {std::numeric_limits<TIME>::infinity()}},
+        });
+
+    add_sink<TIME, REAL, 2>(grid);
+    // the auditor keeps counting all 4 particles, and their momentum and energy, while some of them are spilled
+    conservation_auditor_model<TIME, REAL, 2>::settings_type audit{};
+    audit.until = 40;
+    add_auditor<TIME, REAL, 2>(grid, audit);
+    // a snapshot would lose the spilled particles, so it is not let on
+    try{
+        add_snapshot<TIME, REAL, 2>(grid, std::make_shared<particle_snapshot<TIME, REAL, 2>>());
+    }catch(const std::invalid_argument& e){
+        std::cout << "no snapshot: " << e.what() << "\n";
+    }
+
+
+    dynamic::modeling::Ports iports_TOP{};
+    dynamic::modeling::Ports oports_TOP{};
+    dynamic::modeling::Models submodels_TOP = grid.models;
+    dynamic::modeling::EICs eics_TOP{};
+    dynamic::modeling::EOCs eocs_TOP{};
+    dynamic::modeling::ICs ics_TOP = grid.ics;
+
+    std::shared_ptr<dynamic::modeling::coupled<TIME>> TOP = std::make_shared<dynamic::modeling::coupled<TIME>>(
+        "TOP", submodels_TOP, iports_TOP, oports_TOP, eics_TOP, eocs_TOP, ics_TOP
+    );
+
+    /*** Loggers ***/
+    static async_log_sink out_messages("./simulation_results/output_messages.txt");
+    struct oss_sink_messages{
+        static std::ostream& sink(){
+            return out_messages;
+        }
+    };
+    static async_log_sink out_state("./simulation_results/output_state.txt");
+    struct oss_sink_state{
+        static std::ostream& sink(){
+            return out_state;
+        }
+    };
+
+    using state=logger::logger<logger::logger_state, dynamic::logger::formatter<TIME>, oss_sink_state>;
+    using log_messages=logger::logger<logger::logger_messages, dynamic::logger::formatter<TIME>, oss_sink_messages>;
+    using global_time_mes=logger::logger<logger::logger_global_time, dynamic::logger::formatter<TIME>, oss_sink_messages>;
+    using global_time_sta=logger::logger<logger::logger_global_time, dynamic::logger::formatter<TIME>, oss_sink_state>;
+
+    using logger_top=logger::multilogger<state, log_messages, global_time_mes, global_time_sta>;
+
+    /*** Runner call ***/
+    dynamic::engine::runner<TIME, logger_top> r(TOP, {0});
+    //r.run_until(NDTime("00:05:00:000"));
+    std::cout << "Starting it up!\n";
+    r.run_until(TIME{40});
+    std::cout << "Wrapping it up!\n";
+    return 0;
+
+}
@@ -0,0 +1,105 @@
+
+//Cadmium Simulator headers
+#include <cadmium/modeling/ports.hpp>
+#include <cadmium/modeling/dynamic_model.hpp>
+#include <cadmium/modeling/dynamic_model_translator.hpp>
+#include <cadmium/engine/pdevs_dynamic_runner.hpp>
+#include <cadmium/logger/common_loggers.hpp>
+
+
+#include "./../src/blocking_collider_model.hpp"
+#include "./../src/particle.hpp"
+#include "./../src/volume_model.hpp"
+#include "./../src/grid_topology.hpp"
+#include "./../src/async_log_sink.hpp"
+
+#include <iostream>
+#include <chrono>
+#include <algorithm>
+#include <string>
+#include <fstream>
+
+
+/***** Define input port for coupled models *****/
+
+/***** Define input port for coupled models *****/
+
+using namespace cadmium;
+using namespace tps;
+
+using TIME = double;
+using REAL = double;
+
+template<typename TT>
+using particle_2d = particle<TT, REAL, 2>;
+
+int main(int argc, char ** argv) {
+    // the particles get inited in order like this [last_updated, id, species, mass, radius, [position], [velocity], [deferred_dv], deferred_dv_time]
+
+    // the sharded test again, with an auditor checking that every step keeps the particle count, momentum and energy
+    // blocking_collide only gets the impulse right for hits along an axis, so the auditor flags the energy lost in the off axis hits at 4.29 and 16.59
+    // a 4x4 grid of 10x10 volumes, split between 4 collider shards that each own a 2x2 block
+    // every pair of particles here meets on or near the seam between two shards
+    auto grid = make_sharded_grid<TIME, REAL, 2>(
+        {4, 4}, {0.0, 0.0}, {10.0, 10.0}, {2, 2},
+        std::vector<particle_2d<TIME>>{
+            {{0}, {1}, {0}, {1}, {1}, {15, 35}, { 1,  0}, {0}, {std::numeric_limits<TIME>::infinity()}},
+            {{0}, {2}, {0}, {1}, {1}, {25, 35}, {-1,  0}, {0}, {std::numeric_limits<TIME>::infinity()}},
+
+            {{0}, {3}, {0}, {1}, {1}, { 5, 15}, { 0,  1}, {0}, {std::numeric_limits<TIME>::infinity()}},
+            {{0}, {4}, {0}, {1}, {1}, { 5, 27}, { 0, -2}, {0}, {std::numeric_limits<TIME>::infinity()}},
+
+            {{0}, {5}, {0}, {1}, {1}, {15, 15}, { 1,  1}, {0}, {std::numeric_limits<TIME>::infinity()}},
+            {{0}, {6}, {0}, {2}, {1}, {25, 25}, {-1, -1}, {0}, {std::numeric_limits<TIME>::infinity()}},
+
+            {{0}, {7}, {0}, {1}, {1}, {35, 15}, { 0,  2}, {0}, {std::numeric_limits<TIME>::infinity()}},
+            {{0}, {8}, {0}, {1}, {1}, {35, 35}, { 0, -2}, {0}, {std::numeric_limits<TIME>::infinity()}},
+        });
+
+    // told when the run ends, so the last step is checked too
+    conservation_auditor_model<TIME, REAL, 2>::settings_type audit{};
+    audit.until = 30;
+    add_auditor<TIME, REAL, 2>(grid, audit);
+
+
+    dynamic::modeling::Ports iports_TOP{};
+    dynamic::modeling::Ports oports_TOP{};
+    dynamic::modeling::Models submodels_TOP = grid.models;
+    dynamic::modeling::EICs eics_TOP{};
+    dynamic::modeling::EOCs eocs_TOP{};
+    dynamic::modeling::ICs ics_TOP = grid.ics;
+
+    std::shared_ptr<dynamic::modeling::coupled<TIME>> TOP = std::make_shared<dynamic::modeling::coupled<TIME>>(
+        "TOP", submodels_TOP, iports_TOP, oports_TOP, eics_TOP, eocs_TOP, ics_TOP
+    );
+
+    /*** Loggers ***/
+    static async_log_sink out_messages("./simulation_results/output_messages.txt");
+    struct oss_sink_messages{
+        static std::ostream& sink(){
+            return out_messages;
+        }
+    };
+    static async_log_sink out_state("./simulation_results/output_state.txt");
+    struct oss_sink_state{
+        static std::ostream& sink(){
+            return out_state;
+        }
+    };
+
+    using state=logger::logger<logger::logger_state, dynamic::logger::formatter<TIME>, oss_sink_state>;
+    using log_messages=logger::logger<logger::logger_messages, dynamic::logger::formatter<TIME>, oss_sink_messages>;
+    using global_time_mes=logger::logger<logger::logger_global_time, dynamic::logger::formatter<TIME>, oss_sink_messages>;
+    using global_time_sta=logger::logger<logger::logger_global_time, dynamic::logger::formatter<TIME>, oss_sink_state>;
+
+    using logger_top=logger::multilogger<state, log_messages, global_time_mes, global_time_sta>;
+
+    /*** Runner call ***/
+    dynamic::engine::runner<TIME, logger_top> r(TOP, {0});
+    //r.run_until(NDTime("00:05:00:000"));
+    std::cout << "Starting it up!\n";
+    r.run_until(TIME{30});
+    std::cout << "Wrapping it up!\n";
+    return 0;
+
+}
@@ -0,0 +1,108 @@
+
+//Cadmium Simulator headers
+#include <cadmium/modeling/ports.hpp>
+#include <cadmium/modeling/dynamic_model.hpp>
+#include <cadmium/modeling/dynamic_model_translator.hpp>
+#include <cadmium/engine/pdevs_dynamic_runner.hpp>
+#include <cadmium/logger/common_loggers.hpp>
+
+
+#include "./../src/blocking_collider_model.hpp"
+#include "./../src/particle.hpp"
+#include "./../src/volume_model.hpp"
+#include "./../src/grid_topology.hpp"
+#include "./../src/async_log_sink.hpp"
+#include "./../src/filtered_logger.hpp"
+
+#include <iostream>
+#include <chrono>
+#include <algorithm>
+#include <string>
+#include <fstream>
+
+
+/***** Define input port for coupled models *****/
+
+/***** Define input port for coupled models *****/
+
+using namespace cadmium;
+using namespace tps;
+
+using TIME = double;
+using REAL = double;
+
+template<typename TT>
+using particle_2d = particle<TT, REAL, 2>;
+
+int main(int argc, char ** argv) {
+    // the particles get inited in order like this [last_updated, id, species, mass, radius, [position], [velocity], [deferred_dv], deferred_dv_time]
+
+    // the sharded grid again, with every step logged but the volume states written as keyframes and deltas
+    // each volume writes all of its particles every 4th time it is written, and only what changed since its last record in between
+    // python3 atps_output_tools.py --states simulation_results/output_state.txt 30 rebuilds the positions from it
+    auto grid = make_sharded_grid<TIME, REAL, 2>(
+        {4, 4}, {0.0, 0.0}, {10.0, 10.0}, {2, 2},
+        std::vector<particle_2d<TIME>>{
+            {{0}, {1}, {0}, {1}, {1}, {15, 35}, { 1,  0}, {0}, {std::numeric_limits<TIME>::infinity()}},
+            {{0}, {2}, {0}, {1}, {1}, {25, 35}, {-1,  0}, {0}, {std::numeric_limits<TIME>::infinity()}},
+
+            {{0}, {3}, {0}, {1}, {1}, { 5, 15}, { 0,  1}, {0}, {std::numeric_limits<TIME>::infinity()}},
+            {{0}, {4}, {0}, {1}, {1}, { 5, 27}, { 0, -2}, {0}, {std::numeric_limits<TIME>::infinity()}},
+
+            {{0}, {5}, {0}, {1}, {1}, {15, 15}, { 1,  1}, {0}, {std::numeric_limits<TIME>::infinity()}},
+            {{0}, {6}, {0}, {2}, {1}, {25, 25}, {-1, -1}, {0}, {std::numeric_limits<TIME>::infinity()}},
+
+            {{0}, {7}, {0}, {1}, {1}, {35, 15}, { 0,  2}, {0}, {std::numeric_limits<TIME>::infinity()}},
+            {{0}, {8}, {0}, {1}, {1}, {35, 35}, { 0, -2}, {0}, {std::numeric_limits<TIME>::infinity()}},
+        });
+
+
+    dynamic::modeling::Ports iports_TOP{};
+    dynamic::modeling::Ports oports_TOP{};
+    dynamic::modeling::Models submodels_TOP = grid.models;
+    dynamic::modeling::EICs eics_TOP{};
+    dynamic::modeling::EOCs eocs_TOP{};
+    dynamic::modeling::ICs ics_TOP = grid.ics;
+
+    std::shared_ptr<dynamic::modeling::coupled<TIME>> TOP = std::make_shared<dynamic::modeling::coupled<TIME>>(
+        "TOP", submodels_TOP, iports_TOP, oports_TOP, eics_TOP, eocs_TOP, ics_TOP
+    );
+
+    /*** Loggers ***/
+    static log_filter top_filter{};
+    top_filter.keyframe_every = 4;
+    struct filter_top{
+        static log_filter& filter(){
+            return top_filter;
+        }
+    };
+
+    static async_log_sink out_messages("./simulation_results/output_messages.txt");
+    struct oss_sink_messages{
+        static std::ostream& sink(){
+            return out_messages;
+        }
+    };
+    static async_log_sink out_state("./simulation_results/output_state.txt");
+    struct oss_sink_state{
+        static std::ostream& sink(){
+            return out_state;
+        }
+    };
+
+    using state=logger::logger<logger::logger_state, dynamic::logger::formatter<TIME>, oss_sink_state>;
+    using log_messages=logger::logger<logger::logger_messages, dynamic::logger::formatter<TIME>, oss_sink_messages>;
+    using global_time_mes=logger::logger<logger::logger_global_time, dynamic::logger::formatter<TIME>, oss_sink_messages>;
+    using global_time_sta=logger::logger<logger::logger_global_time, dynamic::logger::formatter<TIME>, oss_sink_state>;
+
+    using logger_top=filtered_logger<logger::multilogger<state, log_messages, global_time_mes, global_time_sta>, filter_top>;
+
+    /*** Runner call ***/
+    dynamic::engine::runner<TIME, logger_top> r(TOP, {0});
+    //r.run_until(NDTime("00:05:00:000"));
+    std::cout << "Starting it up!\n";
+    r.run_until(TIME{30});
+    std::cout << "Wrapping it up!\n";
+    return 0;
+
+}
@@ -0,0 +1,178 @@
+//Cadmium Simulator headers
+#include <cadmium/modeling/ports.hpp>
+#include <cadmium/modeling/dynamic_model.hpp>
+#include <cadmium/modeling/dynamic_model_translator.hpp>
+#include <cadmium/engine/pdevs_dynamic_runner.hpp>
+#include <cadmium/logger/common_loggers.hpp>
+
+
+#include "./../src/blocking_collider_model.hpp"
+#include "./../src/particle.hpp"
+#include "./../src/volume_model.hpp"
+#include "./../src/grid_topology.hpp"
+#include "./../src/snapshot_model.hpp"
+#include "./../src/transport.hpp"
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <iostream>
+#include <memory>
+#include <algorithm>
+#include <string>
+#include <fstream>
+#include <sstream>
+#include <map>
+#include <cmath>
+
+
+/***** Define input port for coupled models *****/
+
+/***** Define input port for coupled models *****/
+
+using namespace cadmium;
+using namespace tps;
+
+using TIME = double;
+using REAL = double;
+
+template<typename TT>
+using particle_2d = particle<TT, REAL, 2>;
+
+//where each particle is at each whole time, as far as the volumes of this process know
+using positions = std::map<TIME, std::map<std::size_t, std::array<REAL, 2>>>;
+
+const TIME end_time = 30;
+
+//the particles of 2d_8p_16v_two_rank_test, plus 9 and 10 in the bottom row
+//9 crosses into the right half at t=2.2 and 10, still on the left, catches it up at t=2.4, before the sync at 2.5 hands 9 over
+std::vector<particle_2d<TIME>> particles(){
+    return {
+        {{0}, {1}, {0}, {1}, {1}, {15, 35}, { 1,  0}, {0}, {std::numeric_limits<TIME>::infinity()}},
+        {{0}, {2}, {0}, {1}, {1}, {25, 35}, {-1,  0}, {0}, {std::numeric_limits<TIME>::infinity()}},
+
+        {{0}, {3}, {0}, {1}, {1}, { 5, 15}, { 0,  1}, {0}, {std::numeric_limits<TIME>::infinity()}},
+        {{0}, {4}, {0}, {1}, {1}, { 5, 27}, { 0, -2}, {0}, {std::numeric_limits<TIME>::infinity()}},
+
+        {{0}, {5}, {0}, {1}, {1}, {15, 15}, { 1,  1}, {0}, {std::numeric_limits<TIME>::infinity()}},
+        {{0}, {6}, {0}, {2}, {1}, {25, 25}, {-1, -1}, {0}, {std::numeric_limits<TIME>::infinity()}},
+
+        {{0}, {7}, {0}, {1}, {1}, {35, 15}, { 0,  2}, {0}, {std::numeric_limits<TIME>::infinity()}},
+        {{0}, {8}, {0}, {1}, {1}, {35, 35}, { 0, -2}, {0}, {std::numeric_limits<TIME>::infinity()}},
+
+        {{0}, {9}, {0}, {1}, {1}, {17.8, 5}, { 1,  0}, {0}, {std::numeric_limits<TIME>::infinity()}},
+        {{0}, {10}, {0}, {1}, {1}, {8.6, 5}, { 4,  0}, {0}, {std::numeric_limits<TIME>::infinity()}},
+    };
+}
+
+positions run(const rank_partition<TIME>& partition){
+    grid_settings<TIME, REAL, 2> settings{};
+    settings.partition = partition;
+    auto grid = make_sharded_grid<TIME, REAL, 2>({4, 4}, {0.0, 0.0}, {10.0, 10.0}, {2, 2}, particles(), true, settings);
+    auto snapshot = std::make_shared<particle_snapshot<TIME, REAL, 2>>();
+    add_snapshot<TIME, REAL, 2>(grid, snapshot);
+
+    dynamic::modeling::Ports iports_TOP{};
+    dynamic::modeling::Ports oports_TOP{};
+    dynamic::modeling::Models submodels_TOP = grid.models;
+    dynamic::modeling::EICs eics_TOP{};
+    dynamic::modeling::EOCs eocs_TOP{};
+    dynamic::modeling::ICs ics_TOP = grid.ics;
+
+    std::shared_ptr<dynamic::modeling::coupled<TIME>> TOP = std::make_shared<dynamic::modeling::coupled<TIME>>(
+        "TOP", submodels_TOP, iports_TOP, oports_TOP, eics_TOP, eocs_TOP, ics_TOP
+    );
+
+    positions out{};
+    dynamic::engine::runner<TIME, logger::not_logger> r(TOP, {0});
+    for(TIME t = 0; t <= end_time; t += 1){
+        //every whole time is also a sync, so no particle is on its way between the two processes when the snapshot is taken
+        r.run_until(std::nextafter(t, std::numeric_limits<TIME>::infinity()));
+        snapshot->take(t);
+        for(std::size_t k = 0; k<snapshot->size(); k++){
+            out[t][snapshot->id[k]] = {snapshot->position[2*k], snapshot->position[2*k+1]};
+        }
+    }
+    return out;
+}
+
+void write_positions(const positions& pos, const std::string& path){
+    std::ofstream out(path);
+    out.precision(17);
+    for(const auto& tkv : pos){
+        for(const auto& pkv : tkv.second){
+            out << tkv.first << " " << pkv.first << " " << pkv.second[0] << " " << pkv.second[1] << "\n";
+        }
+    }
+}
+
+void read_positions(positions& pos, const std::string& path){
+    std::ifstream in(path);
+    TIME t;
+    std::size_t id;
+    std::array<REAL, 2> p;
+    while(in >> t >> id >> p[0] >> p[1]){
+        pos[t][id] = p;
+    }
+}
+
+int main(int argc, char ** argv) {
+    // the same grid run twice, once in this process and once split down the middle between two, syncing every 0.5
+    // every whole time, each particle from the split run that is not where it is in the single one is printed with how far off it is
+    // 1 and 2, and 5 and 6, meet on the line between the processes right at a sync, the left process finds both hits and 2 and 6 on the right get their kicks one sync late
+    // 9 is still a ghost on the left when 10 hits it, so the two of them meet on time and are never off
+    std::cout << "Starting it up!\n";
+    const positions single = run({});
+    //or the child prints it again
+    std::cout.flush();
+
+    auto fds = unix_socket_transport::make_pair();
+    const pid_t child = fork();
+    if(child < 0){
+        std::cerr << "fork failed\n";
+        return 1;
+    }
+    const std::size_t rank = child == 0 ? 1 : 0;
+    close(fds[1-rank]);
+    auto link = std::make_shared<unix_socket_transport>(fds[rank]);
+
+    const positions split = run({rank, 2, rank == 1 ? link : nullptr, rank == 0 ? link : nullptr, TIME{0.5}});
+    const std::string path = "./simulation_results/two_rank_diff_" + std::to_string(rank) + ".txt";
+    write_positions(split, path);
+    if(child == 0){
+        return 0;
+    }
+    int status = 0;
+    waitpid(child, &status, 0);
+
+    //both halves together
+    positions merged{};
+    read_positions(merged, "./simulation_results/two_rank_diff_0.txt");
+    read_positions(merged, "./simulation_results/two_rank_diff_1.txt");
+
+    //every particle that is not where it is in the single run, and how far off it is
+    bool same = true;
+    for(const auto& tkv : single){
+        const auto& other = merged[tkv.first];
+        std::cout << tkv.first;
+        for(const auto& pkv : tkv.second){
+            auto it = other.find(pkv.first);
+            if(it == other.end()){
+                same = false;
+                std::cout << " " << pkv.first << ":missing";
+                continue;
+            }
+            const REAL off = std::hypot(it->second[0]-pkv.second[0], it->second[1]-pkv.second[1]);
+            if(off >= REAL{1e-9}){
+                same = false;
+                std::cout << " " << pkv.first << ":" << off;
+            }
+        }
+        same &= other.size() == tkv.second.size();
+        std::cout << "\n";
+    }
+    std::cout << "positions " << (same ? "match" : "differ") << "\n";
+    std::cout << "Wrapping it up!\n";
+    return WIFEXITED(status) ? WEXITSTATUS(status) : 1;
+
+}
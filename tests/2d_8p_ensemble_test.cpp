@@ -0,0 +1,40 @@
+//Cadmium Simulator headers
+#include <cadmium/modeling/ports.hpp>
+#include <cadmium/modeling/dynamic_model.hpp>
+#include <cadmium/modeling/dynamic_model_translator.hpp>
+#include <cadmium/engine/pdevs_dynamic_runner.hpp>
+#include <cadmium/logger/common_loggers.hpp>
+
+
+#include "./../src/particle.hpp"
+#include "./../src/scenario_loader.hpp"
+#include "./../src/ensemble_runner.hpp"
+
+#include <iostream>
+#include <string>
+
+
+using namespace cadmium;
+using namespace tps;
+
+using TIME = double;
+using REAL = double;
+
+int main(int argc, char ** argv) {
+    // the planned scenario as an ensemble, all of it in one process, as it is, with particle 1 at half speed, and swept over losses and extra_push
+    // the cases run 3 at a time, then again one after the other, and both should give exactly the same results
+    // momentum holds in every case, and the energy left falls as losses go up
+    const std::string ensemble_path = argc > 1 ? argv[1] : "./tests/scenarios/2d_8p_ensemble.json";
+    auto ens = load_ensemble<TIME, REAL, 2>(ensemble_path);
+
+    std::cout << "Starting it up!\n";
+    const auto results = ensemble_results_json<TIME, REAL, 2>(ens.run(), false);
+    std::cout << results.dump(1) << "\n";
+
+    ens.threads = 1;
+    const auto in_line = ensemble_results_json<TIME, REAL, 2>(ens.run(), false);
+    std::cout << "same in line: " << (in_line == results ? "yes" : "no") << "\n";
+    std::cout << "Wrapping it up!\n";
+    return 0;
+
+}
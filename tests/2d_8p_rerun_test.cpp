@@ -0,0 +1,110 @@
+
+//Cadmium Simulator headers
+#include <cadmium/modeling/ports.hpp>
+#include <cadmium/modeling/dynamic_model.hpp>
+#include <cadmium/modeling/dynamic_model_translator.hpp>
+#include <cadmium/engine/pdevs_dynamic_runner.hpp>
+#include <cadmium/logger/common_loggers.hpp>
+
+
+#include "./../src/blocking_collider_model.hpp"
+#include "./../src/particle.hpp"
+#include "./../src/volume_model.hpp"
+#include "./../src/grid_topology.hpp"
+#include "./../src/scenario_loader.hpp"
+#include "./../src/async_log_sink.hpp"
+
+#include <iostream>
+#include <chrono>
+#include <algorithm>
+#include <string>
+#include <fstream>
+#include <sstream>
+
+
+/***** Define input port for coupled models *****/
+
+/***** Define input port for coupled models *****/
+
+using namespace cadmium;
+using namespace tps;
+
+using TIME = double;
+using REAL = double;
+
+//where the loggers of the run that is going write to
+static async_log_sink* out_messages = nullptr;
+static async_log_sink* out_state = nullptr;
+
+struct oss_sink_messages{
+    static std::ostream& sink(){
+        return *out_messages;
+    }
+};
+struct oss_sink_state{
+    static std::ostream& sink(){
+        return *out_state;
+    }
+};
+
+using state=logger::logger<logger::logger_state, dynamic::logger::formatter<TIME>, oss_sink_state>;
+using log_messages=logger::logger<logger::logger_messages, dynamic::logger::formatter<TIME>, oss_sink_messages>;
+using global_time_mes=logger::logger<logger::logger_global_time, dynamic::logger::formatter<TIME>, oss_sink_messages>;
+using global_time_sta=logger::logger<logger::logger_global_time, dynamic::logger::formatter<TIME>, oss_sink_state>;
+
+using logger_top=logger::multilogger<state, log_messages, global_time_mes, global_time_sta>;
+
+//builds the grid from scratch and runs it, with the logs going to files named after the run
+void run(const scenario<TIME, REAL, 2>& sc, const std::string& name){
+    auto grid = sc.make_grid();
+
+    dynamic::modeling::Ports iports_TOP{};
+    dynamic::modeling::Ports oports_TOP{};
+    dynamic::modeling::Models submodels_TOP = grid.models;
+    dynamic::modeling::EICs eics_TOP{};
+    dynamic::modeling::EOCs eocs_TOP{};
+    dynamic::modeling::ICs ics_TOP = grid.ics;
+
+    std::shared_ptr<dynamic::modeling::coupled<TIME>> TOP = std::make_shared<dynamic::modeling::coupled<TIME>>(
+        "TOP", submodels_TOP, iports_TOP, oports_TOP, eics_TOP, eocs_TOP, ics_TOP
+    );
+
+    async_log_sink messages("./simulation_results/" + name + "_messages.txt");
+    async_log_sink states("./simulation_results/" + name + "_state.txt");
+    out_messages = &messages;
+    out_state = &states;
+
+    dynamic::engine::runner<TIME, logger_top> r(TOP, {0});
+    r.run_until(sc.end_time);
+
+    messages.close();
+    states.close();
+    out_messages = nullptr;
+    out_state = nullptr;
+}
+
+std::string read_all(const std::string& path){
+    std::ifstream in(path);
+    std::stringstream ss;
+    ss << in.rdbuf();
+    return ss.str();
+}
+
+int main(int argc, char ** argv) {
+    // the planned grid from 2d_8p_scenario_test, all on one rank, built and run twice in the same process
+    // nothing a run leaves behind may reach the next one, so both runs have to log exactly the same thing
+    // this used to depend on volume_model's global_time, which was never initialized and only read as 0 on fresh heap memory
+    const std::string scenario_path = argc > 1 ? argv[1] : "./tests/scenarios/2d_8p_planned.json";
+    const auto sc = load_scenario<TIME, REAL, 2>(scenario_path);
+
+    std::cout << "Starting it up!\n";
+    run(sc, "rerun_first");
+    run(sc, "rerun_second");
+
+    const bool same_messages = read_all("./simulation_results/rerun_first_messages.txt") == read_all("./simulation_results/rerun_second_messages.txt");
+    const bool same_state = read_all("./simulation_results/rerun_first_state.txt") == read_all("./simulation_results/rerun_second_state.txt");
+    std::cout << "messages " << (same_messages ? "match" : "differ") << ", state " << (same_state ? "matches" : "differs") << "\n";
+    std::cout << "Wrapping it up!\n";
+    return 0;
+
+}
@@ -0,0 +1,72 @@
+
+//Cadmium Simulator headers
+#include <cadmium/modeling/ports.hpp>
+#include <cadmium/modeling/dynamic_model.hpp>
+#include <cadmium/modeling/dynamic_model_translator.hpp>
+#include <cadmium/engine/pdevs_dynamic_runner.hpp>
+#include <cadmium/logger/common_loggers.hpp>
+
+
+#include "./../src/particle.hpp"
+#include "./../src/grid_topology.hpp"
+#include "./../src/scenario_loader.hpp"
+#include "./../src/snapshot_model.hpp"
+
+#include <iostream>
+#include <chrono>
+#include <algorithm>
+#include <string>
+#include <fstream>
+#include <cmath>
+#include <limits>
+
+
+/***** Define input port for coupled models *****/
+
+/***** Define input port for coupled models *****/
+
+using namespace cadmium;
+using namespace tps;
+
+using TIME = double;
+using REAL = double;
+
+int main(int argc, char ** argv) {
+    // the planned scenario again, with no logging, run a step of 1 at a time and read back through a snapshot, the way atps_native.py does it
+    // every line is the time then each particle's id and position, which should match the positions in the scenario test's log
+    const std::string scenario_path = argc > 1 ? argv[1] : "./tests/scenarios/2d_8p_planned.json";
+    const auto sc = load_scenario<TIME, REAL, 2>(scenario_path);
+
+    auto grid = sc.make_grid();
+    auto snapshot = std::make_shared<particle_snapshot<TIME, REAL, 2>>();
+    add_snapshot<TIME, REAL, 2>(grid, snapshot);
+
+
+    dynamic::modeling::Ports iports_TOP{};
+    dynamic::modeling::Ports oports_TOP{};
+    dynamic::modeling::Models submodels_TOP = grid.models;
+    dynamic::modeling::EICs eics_TOP{};
+    dynamic::modeling::EOCs eocs_TOP{};
+    dynamic::modeling::ICs ics_TOP = grid.ics;
+
+    std::shared_ptr<dynamic::modeling::coupled<TIME>> TOP = std::make_shared<dynamic::modeling::coupled<TIME>>(
+        "TOP", submodels_TOP, iports_TOP, oports_TOP, eics_TOP, eocs_TOP, ics_TOP
+    );
+
+    /*** Runner call ***/
+    dynamic::engine::runner<TIME, logger::not_logger> r(TOP, {0});
+    std::cout << "Starting it up!\n";
+    for(TIME t = 0; t <= std::min(sc.end_time, TIME{30}); t += 1){
+        //the runner stops short of the time it is given, what happens at t has to be in the snapshot for t
+        r.run_until(std::nextafter(t, std::numeric_limits<TIME>::infinity()));
+        snapshot->take(t);
+        std::cout << t;
+        for(std::size_t k = 0; k<snapshot->size(); k++){
+            std::cout << " " << snapshot->id[k] << ":[" << snapshot->position[2*k] << ", " << snapshot->position[2*k+1] << "]";
+        }
+        std::cout << "\n";
+    }
+    std::cout << "Wrapping it up!\n";
+    return 0;
+
+}